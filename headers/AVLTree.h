@@ -2,26 +2,42 @@
 #include <iostream>
 #include <memory>
 #include <concepts>
-#include "ITree.h"
+#include "TreeBase.h"
+#include "BatchLookup.h"
+#include "TreeFinger.h"
 #include <stack>
 #include <queue>
 #include <numeric>
 #include <algorithm>
-
-template <std::totally_ordered T>
-class AVLTree : public ITree<T> {
+#include <ranges>
+#include <vector>
+#include <span>
+#include <stdexcept>
+#include <array>
+#include "ParallelBuild.h"
+#include "Augmentation.h"
+#include <atomic>
+
+// OrderStatistics = true хранит в узлах размеры поддеревьев (rank/select/count_range),
+// Aggregate - политика агрегата поддерева (SumAggregate, MaxAggregate ...; см. Augmentation.h)
+template <std::totally_ordered T, bool OrderStatistics = false, typename Aggregate = NoAggregate>
+	requires AggregatePolicy<Aggregate, T>
+class AVLTree : public TreeBase<AVLTree<T, OrderStatistics, Aggregate>, T> {
+	friend TreeBase<AVLTree, T>;  // root/node_count и хуки для общего кода
 
 public:
 
-	struct Node { //структура для узла 
+	struct Node : SubtreeSize<OrderStatistics>, SubtreeAggregate<T, Aggregate> { //структура для узла 
+		using aggregate_policy = Aggregate;
+
 		T key;
 		std::unique_ptr<Node> left;
 		std::unique_ptr<Node> right;
 		int height;
 
 		//Конструкторы и присваивание
-		explicit Node(const T& k)
-			: key(k), left(nullptr), right(nullptr), height(0) {
+		explicit Node(T k)
+			: SubtreeAggregate<T, Aggregate>(k), key(std::move(k)), left(nullptr), right(nullptr), height(0) {
 		}
 
 		//Копирование
@@ -46,6 +62,7 @@ public:
 			int left_height = left ? left->height : -1;
 			int right_height = right ? right->height : -1;
 			height = 1 + std::max(left_height, right_height);
+			update_augmentation(this);
 		}
 
 		// Баланс-фактор
@@ -81,10 +98,11 @@ public:
 	AVLTree(AVLTree&& other) noexcept
 		: root(std::move(other.root)), node_count(other.node_count) {
 		other.root = nullptr;
+		other.finger.reset();
 	}
 
-	virtual ~AVLTree() {
-		clear();
+	~AVLTree() {
+		this->clear();
 	};
 
 	// Оператор копирующего присваивания
@@ -92,43 +110,48 @@ public:
 		if (this != &other) {
 			root = clone(other.root.get());
 			node_count = other.node_count;
+			finger.reset();
 		}
 		return *this;
 	};
 
 	// Оператор перемещающего присваивания
 	AVLTree& operator=(AVLTree&& other) noexcept {
-		clear();
+		this->clear();
 		root = std::move(other.root);
 		node_count = other.node_count;
 		other.root = nullptr;
 		other.node_count = 0;
+		other.finger.reset();
 		return *this;
 	};
 
 	//--------- Основные операции -------//
-	//вставка (рекурсивно)
-	void insert(const T& key) override {		
-		
-		bool height_changed = false;
-		root = insert_impl(std::move(root), key, height_changed);
-		
-	};
+	//вставка (итеративно): путь начинается от пальца - последнего вставленного
+	//ключа, поэтому ключ правее максимума встаёт за амортизированное O(1)
+	//плюс балансировку (для деревьев с агрегатами поля пересчитываются по всему пути).
+	//Возвращает указатель на ключ в дереве и true, если ключ добавлен
+	std::pair<const T*, bool> insert(const T& key) {
+		return insert_key(key);
+	}
 
-	//поиск элемента
-	bool contains(const T& key) const override {
-		// Ранний выход для пустого дерева
-		if (!root) return false;
+	//вставка перемещением: тяжёлый ключ не копируется
+	std::pair<const T*, bool> insert(T&& key) {
+		return insert_key(std::move(key));
+	}
 
+	//поиск элемента: одно трёхстороннее сравнение на уровень. K - сам T или
+	//сравнимый с ним тип запроса (std::string_view для строк), T не строится
+	template<typename K = T> requires LookupKey<K, T>
+	bool contains(const K& key) const {
 		const Node* current = root.get();
 
-		if (key == current->key) return true;
-
 		while (current) {
-			if (key < current->key) {
+			const auto order = compare_keys(key, current->key);
+			if (order < 0) {
 				current = current->left.get();
 			}
-			else if (key > current->key) {
+			else if (order > 0) {
 				current = current->right.get();
 			}
 			else {
@@ -138,164 +161,303 @@ public:
 		return false;
 	};
 
-	//удаление элемента
-	void remove(const T& key) override {
-		bool height_changed = false;
-		root = remove_impl(std::move(root), key, height_changed);
+	//поиск от пальца: подъём от ключа прошлой операции до общего поддерева
+	//и спуск оттуда. Для близких друг к другу ключей O(1) вместо O(log n)
+	bool contains_near(const T& key) {
+		return finger.seek(root, key) != nullptr;
 	}
 
-	//очистка дерева (итеративно)
-	void clear() override {
-		if (!root) return;
+	//пакетный поиск: out[i] = contains(keys[i]). Спуски идут группой по
+	//LOOKUP_GROUP с предвыборкой узлов, и промахи кэша перекрываются
+	void contains_many(std::span<const T> keys, std::span<bool> out) const {
+		contains_many_in(root.get(), keys, out);
+	}
 
-		std::stack<std::unique_ptr<Node>> node_stack;
-		node_stack.push(std::move(root));  // Перемещаем владение в стек
+	//удаление элемента (итеративно, по сохранённому пути)
+	void remove(const T& key) {
+		Path path;
+		size_t depth = 0;
+		path[0] = &root;
+
+		while (*path[depth]) {
+			Node* current = path[depth]->get();
+			const auto order = compare_keys(key, current->key);
+			if (order < 0) {
+				path[depth + 1] = &current->left;
+			}
+			else if (order > 0) {
+				path[depth + 1] = &current->right;
+			}
+			else {
+				break;
+			}
+			++depth;
+		}
 
-		while (!node_stack.empty()) {
-			auto node = std::move(node_stack.top());
-			node_stack.pop();
+		if (!*path[depth]) return;  // Ключ не найден
+		finger.reset();
 
-			// Перемещаем детей в стек перед удалением node
-			if (node->left) {
-				node_stack.push(std::move(node->left));
+		Node* target = path[depth]->get();
+		if (target->left && target->right) {
+			// Продолжаем путь до минимума правого поддерева и забираем его ключ,
+			// чтобы не спускаться к преемнику второй раз
+			path[++depth] = &target->right;
+			while ((*path[depth])->left) {
+				path[depth + 1] = &(*path[depth])->left;
+				++depth;
 			}
-			if (node->right) {
-				node_stack.push(std::move(node->right));
+			target->key = std::move((*path[depth])->key);
+		}
+
+		// У удаляемого узла не более одного ребёнка - он встаёт на его место
+		std::unique_ptr<Node>& removed = *path[depth];
+		std::unique_ptr<Node> child = removed->left
+			? std::move(removed->left) : std::move(removed->right);
+		removed = std::move(child);
+		--node_count;
+		if constexpr (Augmented) {
+			for (size_t i = depth; i-- > 0;) {
+				update_augmentation(path[i]->get());
 			}
 		}
 
-		node_count = 0;
+		// Поднимаемся, пока меняется высота
+		while (depth > 0) {
+			std::unique_ptr<Node>& slot = *path[--depth];
+			int old_height = slot->height;
+			slot->upd_height();
+
+			int bf = slot->balance_factor();
+			if (bf > 1 || bf < -1) {
+				slot = balance(std::move(slot));
+			}
+			if (slot->height == old_height) return;
+		}
 	}
 
-	//--------- Состояние -------//
-	//проверка на пустоту
-	bool empty() const override {
-		return !root;
-	};
+	//--------- Массовое построение -------//
+	//построение идеально сбалансированного дерева из строго возрастающих ключей за O(n);
+	//прежнее содержимое заменяется
+	template<std::ranges::input_range Range>
+		requires std::convertible_to<std::ranges::range_reference_t<Range>, T>
+	void build_from_sorted(Range&& keys) {
+		auto nodes = make_sorted_nodes(keys);  // при ошибке дерево не меняется
+
+		this->clear();
+		node_count = nodes.size();
+		root = build_balanced(nodes, 0, nodes.size());
+	}
 
-	// --------- Публичные методы обходов --------- //
-	std::vector<T> inorder() const override {
-		std::vector<T> result;
-		if (root) {
-			result.reserve(node_count);
-			inorder_impl([&](const T& key) { result.emplace_back(key); });
-		}
-		return result;
+	//параллельное построение из неупорядоченных ключей, дубликаты отбрасываются:
+	//параллельная сортировка, затем верхние уровни делят поддеревья между потоками;
+	//прежнее содержимое заменяется
+	void build_from_unsorted(std::vector<T> keys, unsigned threads = default_build_threads()) {
+		parallel_sort_unique(keys, threads);
+		auto new_root = build_balanced_parallel(keys, 0, keys.size(), threads);
+
+		this->clear();
+		root = std::move(new_root);
+		node_count = keys.size();
 	}
 
-	std::vector<T> preorder() const override {
-		std::vector<T> result;
-		if (root) {
-			result.reserve(node_count);
-			preorder_impl([&](const T& key) { result.emplace_back(key); });
-		}
-		return result;
+	//--------- Операции над множествами -------//
+	// Алгоритмы на split/join за O(m log(n/m + 1)); other передаётся по значению
+	// (std::move, чтобы не копировать) и поглощается. Пока хватает потоков,
+	// рекурсивные ветви выполняются параллельно.
+
+	//объединение: дерево получает ключи other
+	void union_with(AVLTree other, unsigned threads = default_build_threads()) {
+		std::atomic<size_t> matches = 0;
+		size_t total = node_count + other.node_count;
+		root = union_impl(std::move(root), std::move(other.root), matches,
+			set_op_threads(total, threads));
+		node_count = total - matches;
+		other.node_count = 0;
+		finger.reset();
+	}
+
+	//пересечение: остаются только ключи, которые есть и в other
+	void intersect_with(AVLTree other, unsigned threads = default_build_threads()) {
+		std::atomic<size_t> matches = 0;
+		root = intersect_impl(std::move(root), std::move(other.root), matches,
+			set_op_threads(node_count + other.node_count, threads));
+		node_count = matches;
+		other.node_count = 0;
+		finger.reset();
 	}
 
-	std::vector<T> postorder() const override {
-		std::vector<T> result;
-		if (root) {
-			result.reserve(node_count);
-			postorder_impl([&](const T& key) { result.emplace_back(key); });
+	//разность: удаляются ключи, которые есть в other
+	void difference_with(AVLTree other, unsigned threads = default_build_threads()) {
+		std::atomic<size_t> matches = 0;
+		root = difference_impl(std::move(root), std::move(other.root), matches,
+			set_op_threads(node_count + other.node_count, threads));
+		node_count -= matches;
+		other.node_count = 0;
+		finger.reset();
+	}
+
+	//--------- Разделение и соединение -------//
+	//разделение на ключи < key и >= key; дерево остаётся пустым.
+	//Сама операция O(log n), плюс подсчёт размера меньшей половины
+	std::pair<AVLTree, AVLTree> split(const T& key) {
+		std::unique_ptr<Node> left, match, right;
+		split_impl(std::move(root), key, left, match, right);
+		if (match) {
+			right = join(nullptr, std::move(match), std::move(right));
+		}
+
+		std::pair<AVLTree, AVLTree> result;
+		if constexpr (OrderStatistics) {
+			result.first.node_count = size_of(left.get());
 		}
+		else {
+			auto [smaller, left_is_smaller] = smaller_subtree_size(left.get(), right.get());
+			result.first.node_count = left_is_smaller ? smaller : node_count - smaller;
+		}
+		result.second.node_count = node_count - result.first.node_count;
+		result.first.root = std::move(left);
+		result.second.root = std::move(right);
+
+		node_count = 0;
+		finger.reset();
 		return result;
 	}
 
-	std::vector<T> level_order() const override {
-		std::vector<T> result;
-		if (root) {
-			result.reserve(node_count);
-			level_order_impl([&](const T& key) { result.emplace_back(key); });
+	//соединение деревьев, где все ключи left меньше ключей right, O(log n)
+	static AVLTree join(AVLTree left, AVLTree right) {
+		if (!left.root) return right;
+		if (!right.root) return left;
+		if (!(max_node(left.root.get())->key < min_node(right.root.get())->key)) {
+			throw std::invalid_argument("join requires all keys of left to be less than keys of right");
 		}
+
+		AVLTree result;
+		result.node_count = left.node_count + right.node_count;
+		result.root = join2(std::move(left.root), std::move(right.root));
+		left.node_count = right.node_count = 0;
 		return result;
 	}
 
-	// --------- Visitor методы  --------- //	
-	void visit_inorder(std::function<void(const T&)> visitor) const override {
-		if (visitor) inorder_impl(visitor);
-	}
-	void visit_preorder(std::function<void(const T&)> visitor) const  override {
-		if (visitor) preorder_impl(visitor);
-	}
-	void visit_postorder(std::function<void(const T&)> visitor) const override {
-		if (visitor) postorder_impl(visitor);
-	}
-	void visit_level_order(std::function<void(const T&)> visitor) const override {
-		if (visitor) level_order_impl(visitor);
-	}
+	//удаление всех ключей из [lo, hi); O(log n) на разрез и склейку
+	//плюс освобождение удалённых узлов. Возвращает число удалённых ключей
+	size_t erase_range(const T& lo, const T& hi) {
+		if (!root || !(lo < hi)) return 0;
 
-	//--------- Метрики -------//
-	//размер
-	size_t size() const override {
-		return node_count;
-	};
+		std::unique_ptr<Node> left, lo_match, rest;
+		split_impl(std::move(root), lo, left, lo_match, rest);
 
-	//высота	
-	int height() const override {
+		std::unique_ptr<Node> middle, hi_match, right;
+		split_impl(std::move(rest), hi, middle, hi_match, right);
 
-		if (!root) return -1;
-		std::queue<const Node*> q;
-		q.push(root.get());
-		int height = -1;
+		// hi в диапазон не входит и возвращается на место
+		root = hi_match
+			? join(std::move(left), std::move(hi_match), std::move(right))
+			: join2(std::move(left), std::move(right));
 
-		while (!q.empty()) {
-			int levelSize = q.size();
-			height++;
+		size_t erased = destroy_subtree(std::move(middle)) + (lo_match ? 1 : 0);
+		node_count -= erased;
+		finger.reset();
+		return erased;
+	}
 
-			for (int i = 0; i < levelSize; i++) {
-				const Node* current = q.front();
-				q.pop();
+	//--------- Порядковые статистики -------//
+	//доступны при OrderStatistics = true, O(log n)
 
-				if (current->left) q.push(current->left.get());
-				if (current->right) q.push(current->right.get());
-			}
+	//число ключей, меньших key
+	size_t rank(const T& key) const requires OrderStatistics {
+		return rank_in(root.get(), key);
+	}
+
+	//k-й по возрастанию ключ (с нуля)
+	const T& select(size_t k) const requires OrderStatistics {
+		const Node* node = select_in(root.get(), k);
+		if (!node) {
+			throw std::out_of_range("select index out of range");
 		}
-		return height;
+		return node->key;
 	}
 
-	//--------- Печать -------//
-	void print(std::ostream& os = std::cout) const override {
+	//число ключей в [lo, hi)
+	size_t count_range(const T& lo, const T& hi) const requires OrderStatistics {
+		return lo < hi ? rank(hi) - rank(lo) : 0;
+	}
 
-		if (!root) {
-			os << "[empty]\n";
-			return;
-		}
+	//--------- Агрегаты поддеревьев -------//
+	//доступны, если задана политика Aggregate, O(log n)
 
-		std::queue<const Node*> q;
-		q.push(root.get());
-		int level = 0;
+	//агрегат всех ключей
+	auto total_aggregate() const requires (!std::same_as<Aggregate, NoAggregate>) {
+		return aggregate_of<Aggregate>(root.get());
+	}
 
-		while (!q.empty()) {
-			int level_size = q.size();
-			os << "Level " << level << ": ";
+	//агрегат ключей из [lo, hi)
+	auto aggregate(const T& lo, const T& hi) const requires (!std::same_as<Aggregate, NoAggregate>) {
+		return range_aggregate<Aggregate>(root.get(), lo, hi);
+	}
+
+	//--------- Итераторы -------//
+	//begin()/end() - в TreeBase (см. TreeIterator.h)
+	using iterator = TreeIterator<Node>;
+	using const_iterator = iterator;
+
+	//--------- Метрики -------//
+	//высота хранится в корне - O(1)
+	int height() const {
+		return root ? root->height : -1;
+	}
 
-			for (int i = 0; i < level_size; ++i) {
-				const Node* current = q.front();
-				q.pop();
 
-				os << current->key;
+protected:
+	// Путь от корня: указатели на unique_ptr, владеющие узлами.
+	// Высота AVL-дерева не больше 1.45·log2(n) < 96, плюс слот для нового узла
+	static constexpr size_t MAX_DEPTH = 96;
+	// В узлах есть поля, пересчитываемые по детям
+	static constexpr bool Augmented = OrderStatistics || !std::same_as<Aggregate, NoAggregate>;
+	using Path = std::array<std::unique_ptr<Node>*, MAX_DEPTH>;
+
+	// --------- Вставка --------- //
+	//один спуск от пальца; ключ перемещается в узел только после сравнений
+	template<typename K>
+	std::pair<const T*, bool> insert_key(K&& key) {
+		std::unique_ptr<Node>& target = finger.seek(root, key);
+		if (target) return { &target->key, false };  // Дубликат
+
+		target = std::make_unique<Node>(std::forward<K>(key));
+		Node* inserted = target.get();  // узлы при поворотах не перемещаются
+		++node_count;
+		size_t depth = finger.depth();
+		if constexpr (Augmented) {
+			// Поля меняются на всём пути, даже выше места, где остановится балансировка
+			for (size_t i = depth; i-- > 0;) {
+				update_augmentation(finger[i].get());
+			}
+		}
 
-				// Показываем связи
-				if (current->left || current->right) {
-					os << "[";
-					if (current->left) os << "L:" << current->left->key;
-					if (current->left && current->right) os << ",";
-					if (current->right) os << "R:" << current->right->key;
-					os << "]";
-				}
-				os << "  ";
+		// Поднимаемся, пока меняется высота
+		while (depth > 0) {
+			std::unique_ptr<Node>& slot = finger[--depth];
+			int old_height = slot->height;
+			slot->upd_height();
 
-				if (current->left) q.push(current->left.get());
-				if (current->right) q.push(current->right.get());
+			int bf = slot->balance_factor();
+			if (bf > 1 || bf < -1) {
+				// После вставки поворот возвращает поддереву прежнюю высоту;
+				// палец остаётся на повёрнутом поддереве
+				slot = balance(std::move(slot));
+				finger.truncate(depth);
+				return { &inserted->key, true };
 			}
-			os << "\n";
-			level++;
+			if (slot->height == old_height) break;
 		}
+		return { &inserted->key, true };
 	}
 
+	// --------- Хуки TreeBase --------- //
+	//после clear() прежний путь указывает на удалённые узлы
+	void on_clear() {
+		finger.reset();
+	}
 
-protected:
-	
 	// --------- Вращения --------- //
 	// Функции принимают владение узлом, возвращают новый корень поддерева
 	static std::unique_ptr<Node> small_rotate_left(std::unique_ptr<Node> x) {
@@ -374,231 +536,294 @@ protected:
 		return node; 	
 	}
 	
-	// --------- Шаблонные реализации обходов --------- //
-	template<typename Action>
-	void inorder_impl(Action&& action) const {
-		if (!root) return;
+	// --------- split / join --------- //
+	static int height_of(const Node* node) {
+		return node ? node->height : -1;
+	}
 
-		std::stack<const Node*> stack;
-		const Node* current = root.get();
+	// Соединение left < mid < right, где mid - отдельный узел: спускаемся по краю
+	// более высокого дерева до поддерева высоты не больше другой стороны + 1,
+	// подвешиваем туда mid и балансируем путь снизу вверх, O(|h(left) - h(right)|)
+	static std::unique_ptr<Node> join(std::unique_ptr<Node> left,
+		std::unique_ptr<Node> mid, std::unique_ptr<Node> right) {
 
-		while (current || !stack.empty()) {
-			while (current) {
-				stack.push(current);
-				current = current->left.get();
-			}
+		int left_height = height_of(left.get());
+		int right_height = height_of(right.get());
+
+		if (std::abs(left_height - right_height) <= 1) {
+			mid->left = std::move(left);
+			mid->right = std::move(right);
+			mid->upd_height();
+			return mid;
+		}
 
-			current = stack.top();
-			stack.pop();
-			action(current->key);  // Вызываем action
+		bool left_taller = left_height > right_height;
+		std::unique_ptr<Node>& taller = left_taller ? left : right;
+		int limit = (left_taller ? right_height : left_height) + 1;
+
+		Path path;
+		size_t depth = 0;
+		path[0] = &taller;
+		while (height_of(path[depth]->get()) > limit) {
+			path[depth + 1] = left_taller ? &(*path[depth])->right : &(*path[depth])->left;
+			++depth;
+		}
+
+		if (left_taller) {
+			mid->left = std::move(*path[depth]);
+			mid->right = std::move(right);
+		}
+		else {
+			mid->right = std::move(*path[depth]);
+			mid->left = std::move(left);
+		}
+		mid->upd_height();
+		*path[depth] = std::move(mid);
 
-			current = current->right.get();
+		while (depth > 0) {
+			std::unique_ptr<Node>& slot = *path[--depth];
+			slot->upd_height();
+			slot = balance(std::move(slot));
 		}
+
+		return std::move(taller);
 	}
 
-	template<typename Action>
-	void preorder_impl(Action&& action) const {
-		if (!root) return;
+	static const Node* min_node(const Node* node) {
+		while (node->left) node = node->left.get();
+		return node;
+	}
 
-		std::stack<const Node*> stack;
-		stack.push(root.get());
+	static const Node* max_node(const Node* node) {
+		while (node->right) node = node->right.get();
+		return node;
+	}
 
-		while (!stack.empty()) {
-			const Node* current = stack.top();
-			stack.pop();
-			action(current->key);
+	// Соединение left < right без среднего узла: средним становится минимум right
+	static std::unique_ptr<Node> join2(std::unique_ptr<Node> left, std::unique_ptr<Node> right) {
+		if (!left) return right;
+		if (!right) return left;
 
-			if (current->right) stack.push(current->right.get());
-			if (current->left) stack.push(current->left.get());
+		// Отцепляем минимум right, балансируя путь к нему
+		Path path;
+		size_t depth = 0;
+		path[0] = &right;
+		while ((*path[depth])->left) {
+			path[depth + 1] = &(*path[depth])->left;
+			++depth;
 		}
-	}
 
-	template<typename Action>
-	void postorder_impl(Action&& action) const {
-		if (!root) return;
+		std::unique_ptr<Node> mid = std::move(*path[depth]);
+		*path[depth] = std::move(mid->right);
 
-		// Два стека
-		std::stack<const Node*> stack1, stack2;
-		stack1.push(root.get());
+		while (depth > 0) {
+			std::unique_ptr<Node>& slot = *path[--depth];
+			slot->upd_height();
+			slot = balance(std::move(slot));
+		}
 
-		while (!stack1.empty()) {
-			const Node* current = stack1.top();
-			stack1.pop();
-			stack2.push(current);
+		return join(std::move(left), std::move(mid), std::move(right));
+	}
 
-			if (current->left) stack1.push(current->left.get());
-			if (current->right) stack1.push(current->right.get());
+	// Разделение по key на < key и > key; узел с key (если есть) отдаётся в match
+	// без детей. Спуск отцепляет узлы пути, подъём собирает половины через join.
+	static void split_impl(std::unique_ptr<Node> tree, const T& key,
+		std::unique_ptr<Node>& left, std::unique_ptr<Node>& match, std::unique_ptr<Node>& right) {
+
+		std::array<std::unique_ptr<Node>, MAX_DEPTH> path;
+		std::array<bool, MAX_DEPTH> went_left;
+		size_t depth = 0;
+
+		while (tree) {
+			const auto order = compare_keys(key, tree->key);
+			if (order < 0) {
+				auto next = std::move(tree->left);
+				went_left[depth] = true;
+				path[depth++] = std::move(tree);
+				tree = std::move(next);
+			}
+			else if (order > 0) {
+				auto next = std::move(tree->right);
+				went_left[depth] = false;
+				path[depth++] = std::move(tree);
+				tree = std::move(next);
+			}
+			else {
+				left = std::move(tree->left);
+				right = std::move(tree->right);
+				match = std::move(tree);
+				break;
+			}
 		}
 
-		while (!stack2.empty()) {
-			action(stack2.top()->key);
-			stack2.pop();
+		while (depth > 0) {
+			auto node = std::move(path[--depth]);
+			if (went_left[depth]) {
+				auto node_right = std::move(node->right);
+				right = join(std::move(right), std::move(node), std::move(node_right));
+			}
+			else {
+				auto node_left = std::move(node->left);
+				left = join(std::move(node_left), std::move(node), std::move(left));
+			}
 		}
 	}
 
-	template<typename Action>
-	void level_order_impl(Action&& action) const {
-		if (!root) return;
+	// --------- Операции над множествами --------- //
+	// Число потоков для операции: мелкие деревья обрабатываем в одном
+	static unsigned set_op_threads(size_t total_size, unsigned threads) {
+		return total_size >= 2 * PARALLEL_MIN_CHUNK ? threads : 1;
+	}
 
-		std::vector<const Node*> current_lvl;
-		current_lvl.push_back(root.get());
+	// Корень a делит b по своему ключу, половины обрабатываются рекурсивно
+	// (левая - на отдельном потоке, пока есть бюджет), затем собираются join
+	static std::unique_ptr<Node> union_impl(std::unique_ptr<Node> a, std::unique_ptr<Node> b,
+		std::atomic<size_t>& matches, unsigned threads) {
 
-		while (!current_lvl.empty()) {
-			std::vector<const Node*> next_lvl;
-			next_lvl.reserve(current_lvl.size() * 2);  // Оптимизация
+		if (!a) return b;
+		if (!b) return a;
 
-			for (const Node* node : current_lvl) {
-				action(node->key);
+		std::unique_ptr<Node> b_left, b_match, b_right;
+		split_impl(std::move(b), a->key, b_left, b_match, b_right);
+		if (b_match) ++matches;
 
-				if (node->left) next_lvl.push_back(node->left.get());
-				if (node->right) next_lvl.push_back(node->right.get());
-			}
+		auto a_left = std::move(a->left);
+		auto a_right = std::move(a->right);
+		std::unique_ptr<Node> left, right;
+		unsigned left_threads = threads / 2;
+		fork_join(threads > 1,
+			[&] { left = union_impl(std::move(a_left), std::move(b_left), matches, left_threads); },
+			[&] { right = union_impl(std::move(a_right), std::move(b_right), matches, threads - left_threads); });
 
-			current_lvl = std::move(next_lvl);
-		}
+		return join(std::move(left), std::move(a), std::move(right));
 	}
 
-	//-------------- Общие служебные функции ---------//
-	
-	//служебная функция копирования дерева (рекурсивная)
-	static std::unique_ptr<Node> clone(const Node* source) {
-		if (!source) return nullptr;
+	static std::unique_ptr<Node> intersect_impl(std::unique_ptr<Node> a, std::unique_ptr<Node> b,
+		std::atomic<size_t>& matches, unsigned threads) {
 
-		auto new_node = std::make_unique<Node>(source->key);
-		new_node->height = source->height;  // копируем высоту
+		if (!a || !b) return nullptr;
 
-		new_node->left = clone(source->left.get());
-		new_node->right = clone(source->right.get());
+		std::unique_ptr<Node> b_left, b_match, b_right;
+		split_impl(std::move(b), a->key, b_left, b_match, b_right);
 
-		return new_node;
-	}
+		auto a_left = std::move(a->left);
+		auto a_right = std::move(a->right);
+		std::unique_ptr<Node> left, right;
+		unsigned left_threads = threads / 2;
+		fork_join(threads > 1,
+			[&] { left = intersect_impl(std::move(a_left), std::move(b_left), matches, left_threads); },
+			[&] { right = intersect_impl(std::move(a_right), std::move(b_right), matches, threads - left_threads); });
 
-	//служебная функция рекурсивной вставки
-	std::unique_ptr<Node> insert_impl(std::unique_ptr<Node> node, const T& key,
-		bool& height_changed) {
-		if (!node) {
-			height_changed = true;
-			++node_count;
-			return std::make_unique<Node>(key);
+		if (b_match) {
+			++matches;
+			return join(std::move(left), std::move(a), std::move(right));
 		}
+		return join2(std::move(left), std::move(right));
+	}
 
-		bool child_height_changed = false;
-		if (key < node->key) {
-			node->left = insert_impl(std::move(node->left), key, child_height_changed);
-		}
-		else if (key > node->key) {
-			node->right = insert_impl(std::move(node->right), key, child_height_changed);
-		}
-		else {
-			height_changed = false;  // Дубликат
-			return node;
-		}
+	static std::unique_ptr<Node> difference_impl(std::unique_ptr<Node> a, std::unique_ptr<Node> b,
+		std::atomic<size_t>& matches, unsigned threads) {
 
-		if (!child_height_changed) {
-			// Высота поддерева не изменилась - пропускаем балансировку
-			height_changed = false;
-			return node;
-		}
+		if (!a) return nullptr;
+		if (!b) return a;
 
-		// Сохраняем старую высоту
-		int old_height = node->height;
-		node->upd_height();
+		std::unique_ptr<Node> b_left, b_match, b_right;
+		split_impl(std::move(b), a->key, b_left, b_match, b_right);
 
-		if (node->height == old_height) {
-			// Высота не изменилась
-			height_changed = false;
-			return node;
-		}
+		auto a_left = std::move(a->left);
+		auto a_right = std::move(a->right);
+		std::unique_ptr<Node> left, right;
+		unsigned left_threads = threads / 2;
+		fork_join(threads > 1,
+			[&] { left = difference_impl(std::move(a_left), std::move(b_left), matches, left_threads); },
+			[&] { right = difference_impl(std::move(a_right), std::move(b_right), matches, threads - left_threads); });
 
-		// Высота изменилась - балансируем
-		height_changed = true;
-		return balance(std::move(node)); 
-	}
-	//--------- рекурсивное удаление
-	// Находим узел с минимальным ключом в поддереве
-	static Node* find_min(Node* node) {
-		while (node && node->left) {
-			node = node->left.get();
+		if (b_match) {
+			++matches;
+			return join2(std::move(left), std::move(right));
 		}
-		return node;
+		return join(std::move(left), std::move(a), std::move(right));
 	}
 
-	// Находим узел с максимальным ключом в поддереве  
-	static Node* find_max(Node* node) {
-		while (node && node->right) {
-			node = node->right.get();
-		}
-		return node;
-	}
-	 //служебная функция рекурсивного удаления
-	std::unique_ptr<Node> remove_impl(std::unique_ptr<Node> node, const T& key, bool& height_changed) {
-		if (!node) {
-			height_changed = false;
-			return nullptr;  // Ключ не найден
+	//узлы для строго возрастающей последовательности ключей (один проход выделения)
+	template<typename Range>
+	static std::vector<std::unique_ptr<Node>> make_sorted_nodes(Range&& keys) {
+		std::vector<std::unique_ptr<Node>> nodes;
+		if constexpr (std::ranges::sized_range<Range>) {
+			nodes.reserve(std::ranges::size(keys));
 		}
 
-		bool child_height_changed = false;
-
-		if (key < node->key) {
-			// Ищем в левом поддереве
-			node->left = remove_impl(std::move(node->left), key, child_height_changed);
-		}
-		else if (key > node->key) {
-			// Ищем в правом поддереве
-			node->right = remove_impl(std::move(node->right), key, child_height_changed);
+		for (auto&& key : keys) {
+			auto node = std::make_unique<Node>(key);
+			if (!nodes.empty() && !(nodes.back()->key < node->key)) {
+				throw std::invalid_argument(
+					"build_from_sorted requires strictly increasing keys");
+			}
+			nodes.push_back(std::move(node));
 		}
-		else {
-			// Нашли узел для удаления
-			height_changed = true;  // Удаление всегда может изменить высоту
+		return nodes;
+	}
 
-			//Узел - лист (нет детей)
-			if (!node->left && !node->right) {
-				--node_count;  // Уменьшаем счетчик
-				return nullptr;
-			}
+	// Сборка сбалансированного дерева из узлов [lo, hi) с вычислением высот
+	static std::unique_ptr<Node> build_balanced(
+		std::vector<std::unique_ptr<Node>>& nodes, size_t lo, size_t hi) {
 
-			//Узел имеет только одного ребенка
-			if (!node->left) {
-				--node_count;  // Уменьшаем счетчик
-				return std::move(node->right);  // Правый ребенок становится на место узла
-			}
-			if (!node->right) {
-				--node_count;  // Уменьшаем счетчик
-				return std::move(node->left);   // Левый ребенок становится на место узла
-			}
+		if (lo >= hi) return nullptr;
 
-			//Узел имеет двух детей
-			// Находим минимальный узел в правом поддереве (ну так захотелось, можно максимальный в правом)
-			Node* successor = find_min(node->right.get());
+		size_t mid = lo + (hi - lo) / 2;
+		auto node = std::move(nodes[mid]);
+		node->left = build_balanced(nodes, lo, mid);
+		node->right = build_balanced(nodes, mid + 1, hi);
+		node->upd_height();
+		return node;
+	}
 
-			// Копируем значение преемника в текущий узел
-			node->key = successor->key;
+	// То же из отсортированных ключей [lo, hi): пока есть свободные потоки,
+	// левое поддерево строится на отдельном потоке
+	static std::unique_ptr<Node> build_balanced_parallel(
+		const std::vector<T>& keys, size_t lo, size_t hi, unsigned threads) {
 
-			// Рекурсивно удаляем преемника
-			node->right = remove_impl(std::move(node->right), successor->key, child_height_changed);
-		}
+		if (lo >= hi) return nullptr;
 
-		// После удаления проверяем балансировку
-		if (child_height_changed) {
-			int old_height = node->height;
-			node->upd_height();
+		size_t mid = lo + (hi - lo) / 2;
+		auto node = std::make_unique<Node>(keys[mid]);
 
-			if (node->height == old_height) {
-				height_changed = false;
-			}
-			else {
-				height_changed = true;
-				return balance(std::move(node));
-			}
+		if (threads > 1 && hi - lo >= 2 * PARALLEL_MIN_CHUNK) {
+			unsigned left_threads = threads / 2;
+			auto left = std::async(std::launch::async, [&keys, lo, mid, left_threads] {
+				return build_balanced_parallel(keys, lo, mid, left_threads);
+			});
+			node->right = build_balanced_parallel(keys, mid + 1, hi, threads - left_threads);
+			node->left = left.get();
 		}
 		else {
-			height_changed = false;
+			node->left = build_balanced_parallel(keys, lo, mid, 1);
+			node->right = build_balanced_parallel(keys, mid + 1, hi, 1);
 		}
 
+		node->upd_height();
 		return node;
-	}	
+	}
+
+	//-------------- Общие служебные функции ---------//
+	
+	//служебная функция копирования дерева (рекурсивная)
+	static std::unique_ptr<Node> clone(const Node* source) {
+		if (!source) return nullptr;
+
+		auto new_node = std::make_unique<Node>(source->key);
+		new_node->height = source->height;  // копируем высоту
+		static_cast<SubtreeSize<OrderStatistics>&>(*new_node) = *source;  // и дополнительные поля
+		static_cast<SubtreeAggregate<T, Aggregate>&>(*new_node) = *source;
+
+		new_node->left = clone(source->left.get());
+		new_node->right = clone(source->right.get());
+
+		return new_node;
+	}
 
 protected:
 	std::unique_ptr<Node> root = nullptr;
 	size_t node_count = 0;
+	TreeFinger<Node> finger;  // путь к узлу последней вставки или contains_near
 };
\ No newline at end of file
@@ -0,0 +1,251 @@
+﻿#pragma once
+#include "TreeShape.h"
+#include <cstddef>
+#include <concepts>
+#include <functional>
+#include <limits>
+#include <type_traits>
+
+// Дополнительные данные поддерева, хранимые в узле:
+// - размер (порядковые статистики: rank/select за O(log n));
+// - агрегат по моноиду, заданному политикой (сумма, минимум, максимум ...).
+// Деревья включают их параметрами шаблона; выключенные поля не занимают места,
+// а служебные функции ничего не делают.
+
+//======== Политики агрегатов =====/
+// Политика описывает моноид над ключами: нейтральный элемент, значение
+// одного ключа и ассоциативную операцию. Коммутативность не требуется -
+// аргументы combine всегда идут в порядке возрастания ключей.
+struct NoAggregate {};
+
+template<typename A, typename T>
+concept AggregatePolicy = std::same_as<A, NoAggregate> || requires(const T& key, const typename A::value_type& value) {
+	{ A::identity() } -> std::convertible_to<typename A::value_type>;
+	{ A::from_key(key) } -> std::convertible_to<typename A::value_type>;
+	{ A::combine(value, value) } -> std::convertible_to<typename A::value_type>;
+};
+
+// Сумма проекций ключей; Value позволяет считать в более широком типе
+template<typename T, typename Value = T, typename Projection = std::identity>
+struct SumAggregate {
+	using value_type = Value;
+
+	static value_type identity() {
+		return value_type{};
+	}
+
+	static value_type from_key(const T& key) {
+		return static_cast<value_type>(Projection{}(key));
+	}
+
+	static value_type combine(const value_type& a, const value_type& b) {
+		return a + b;
+	}
+};
+
+// Минимум проекций ключей
+template<typename T, typename Projection = std::identity>
+struct MinAggregate {
+	using value_type = std::remove_cvref_t<std::invoke_result_t<Projection, const T&>>;
+
+	static value_type identity() {
+		return std::numeric_limits<value_type>::max();
+	}
+
+	static value_type from_key(const T& key) {
+		return Projection{}(key);
+	}
+
+	static value_type combine(const value_type& a, const value_type& b) {
+		return b < a ? b : a;
+	}
+};
+
+// Максимум проекций ключей; например, правый конец отрезка
+// для дерева интервалов с ключами-парами (начало, конец)
+template<typename T, typename Projection = std::identity>
+struct MaxAggregate {
+	using value_type = std::remove_cvref_t<std::invoke_result_t<Projection, const T&>>;
+
+	static value_type identity() {
+		return std::numeric_limits<value_type>::lowest();
+	}
+
+	static value_type from_key(const T& key) {
+		return Projection{}(key);
+	}
+
+	static value_type combine(const value_type& a, const value_type& b) {
+		return a < b ? b : a;
+	}
+};
+
+//======== Поля узла =====/
+// Размер поддерева
+template<bool Enabled>
+struct SubtreeSize {
+	size_t size = 1;
+};
+
+template<>
+struct SubtreeSize<false> {};
+
+// Агрегат поддерева; инициализируется значением ключа самого узла
+template<typename T, typename A>
+struct SubtreeAggregate {
+	typename A::value_type aggregate;
+
+	explicit SubtreeAggregate(const T& key) : aggregate(A::from_key(key)) {}
+};
+
+template<typename T>
+struct SubtreeAggregate<T, NoAggregate> {
+	explicit SubtreeAggregate(const T&) {}
+};
+
+// Размер поддерева (0 для пустого)
+template<typename Node>
+size_t size_of(const Node* node) {
+	return node ? node->size : 0;
+}
+
+// Агрегат поддерева (нейтральный элемент для пустого)
+template<typename A, typename Node>
+typename A::value_type aggregate_of(const Node* node) {
+	return node ? node->aggregate : A::identity();
+}
+
+// Пересчёт дополнительных полей узла по детям
+template<typename Node>
+void update_augmentation(Node* node) {
+	if constexpr (requires { node->size; }) {
+		node->size = 1 + size_of(node->left.get()) + size_of(node->right.get());
+	}
+	if constexpr (requires { node->aggregate; }) {
+		using A = typename Node::aggregate_policy;
+		node->aggregate = A::combine(
+			A::combine(aggregate_of<A>(node->left.get()), A::from_key(node->key)),
+			aggregate_of<A>(node->right.get()));
+	}
+}
+
+// Пересчёт всего поддерева снизу вверх (после массового построения)
+template<typename Node>
+void recompute_augmentation(Node* root) {
+	if constexpr (requires { root->size; } || requires { root->aggregate; }) {
+		if (!root) return;
+
+		// Обратный порядок обхода "корень-правый-левый" даёт детей раньше родителей
+		InlineStack<Node*> stack, order;
+		stack.push(root);
+		while (!stack.empty()) {
+			Node* node = stack.pop();
+			order.push(node);
+			if (node->left) stack.push(node->left.get());
+			if (node->right) stack.push(node->right.get());
+		}
+		while (!order.empty()) {
+			update_augmentation(order.pop());
+		}
+	}
+}
+
+// Узлы, у которых при проходе сверху вниз поменялись поддеревья;
+// apply() пересчитывает их в обратном порядке - от нижних к верхним
+template<typename Node, bool Enabled>
+class AugmentFixup {
+public:
+	void touch(Node* node) {
+		stack.push(node);
+	}
+
+	void apply() {
+		while (!stack.empty()) {
+			update_augmentation(stack.pop());
+		}
+	}
+
+private:
+	InlineStack<Node*> stack;
+};
+
+template<typename Node>
+class AugmentFixup<Node, false> {
+public:
+	void touch(Node*) {}
+	void apply() {}
+};
+
+//======== Запросы =====/
+// Число ключей поддерева, меньших key
+template<typename Node, typename T>
+size_t rank_in(const Node* node, const T& key) {
+	size_t rank = 0;
+	while (node) {
+		if (node->key < key) {
+			rank += size_of(node->left.get()) + 1;
+			node = node->right.get();
+		}
+		else {
+			node = node->left.get();
+		}
+	}
+	return rank;
+}
+
+// Узел с k-м по возрастанию ключом (с нуля); nullptr, если k >= размера
+template<typename Node>
+const Node* select_in(const Node* node, size_t k) {
+	while (node) {
+		size_t left_size = size_of(node->left.get());
+		if (k < left_size) {
+			node = node->left.get();
+		}
+		else if (k > left_size) {
+			k -= left_size + 1;
+			node = node->right.get();
+		}
+		else {
+			return node;
+		}
+	}
+	return nullptr;
+}
+
+// Агрегат ключей из [lo, hi): спуск до узла-развилки, затем по одному пути
+// к каждой границе с добавлением целых поддеревьев, O(высоты)
+template<typename A, typename Node, typename T>
+typename A::value_type range_aggregate(const Node* node, const T& lo, const T& hi) {
+	while (node && !(lo <= node->key && node->key < hi)) {
+		node = node->key < lo ? node->right.get() : node->left.get();
+	}
+	if (!node) return A::identity();
+
+	// Ключи >= lo левого поддерева: собираем справа налево
+	typename A::value_type left = A::identity();
+	for (const Node* current = node->left.get(); current; ) {
+		if (current->key < lo) {
+			current = current->right.get();
+		}
+		else {
+			left = A::combine(A::combine(A::from_key(current->key),
+				aggregate_of<A>(current->right.get())), left);
+			current = current->left.get();
+		}
+	}
+
+	// Ключи < hi правого поддерева: собираем слева направо
+	typename A::value_type right = A::identity();
+	for (const Node* current = node->right.get(); current; ) {
+		if (current->key < hi) {
+			right = A::combine(right, A::combine(aggregate_of<A>(current->left.get()),
+				A::from_key(current->key)));
+			current = current->right.get();
+		}
+		else {
+			current = current->left.get();
+		}
+	}
+
+	return A::combine(A::combine(left, A::from_key(node->key)), right);
+}
@@ -2,14 +2,27 @@
 #include <iostream>
 #include <memory>
 #include <concepts>
-#include "ITree.h"
+#include "TreeBase.h"
+#include "BatchLookup.h"
+#include "TreeFinger.h"
 #include <stack>
 #include <queue>
 #include <numeric>
 #include <algorithm>
-
-template <std::totally_ordered T> 
-class BSTree : public ITree<T> {
+#include <ranges>
+#include <vector>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <type_traits>
+
+// Derived - наследник (ScapegoatTree, SplayTree, ...), передающий себя:
+// общий код TreeBase (emplace, clear и хуки) тогда вызывает его версии.
+// Для самого BSTree параметр не указывается
+template <std::totally_ordered T, typename Derived = void> 
+class BSTree : public TreeBase<std::conditional_t<std::is_void_v<Derived>, BSTree<T>, Derived>, T> {
+	using Self = std::conditional_t<std::is_void_v<Derived>, BSTree<T>, Derived>;
+	friend TreeBase<Self, T>;  // root/node_count и хуки для общего кода
 
 protected:
 	
@@ -19,8 +32,8 @@ protected:
 		std::unique_ptr<Node> right;
 
 		//Конструкторы и присваивание
-		explicit Node(const T& k)
-			: key(k), left(nullptr), right(nullptr) {}			
+		explicit Node(T k)
+			: key(std::move(k)), left(nullptr), right(nullptr) {}			
 		
 		//Копирование
 		Node(const Node&) = delete;
@@ -42,16 +55,19 @@ public:
 	BSTree(T key) : root(std::make_unique<Node>(Node(key))), node_count(1) {};	
 	
 	// Конструктор копирования
-	BSTree(const BSTree& other) : root(clone(other.root.get())), node_count(other.node_count) {};
+	BSTree(const BSTree& other)
+		: root(clone(other.root.get())), node_count(other.node_count), height_cache(other.height_cache) {};
 
 	// Конструктор перемещения
 	BSTree(BSTree&& other) noexcept
-		: root(std::move(other.root)), node_count(other.node_count) {
-		other.root = nullptr;		
+		: root(std::move(other.root)), node_count(other.node_count), height_cache(other.height_cache) {
+		other.root = nullptr;
+		other.shape_changed();
 	}
 
-	virtual ~BSTree() {
-		clear();		
+	// Не через clear(): часть наследника к этому моменту уже разрушена
+	~BSTree() {
+		destroy_subtree(std::move(root));
 	};
 
 	// Оператор копирующего присваивания
@@ -59,41 +75,48 @@ public:
 		if (this != &other) {
 			root = clone(other.root.get());
 			node_count = other.node_count;
+			height_cache = other.height_cache;
+			finger.reset();
 		}
 		return *this;
 	};
 
 	// Оператор перемещающего присваивания
 	BSTree& operator=(BSTree&& other) noexcept {
-		clear();
+		this->clear();
 		root = std::move(other.root);
 		node_count = other.node_count;
+		height_cache = other.height_cache;
 		other.root = nullptr;
-		other.node_count = 0;		
+		other.node_count = 0;
+		other.shape_changed();
 		return *this;
 	};
 	
 	//--------- Основные операции -------//
-	//вставка (итеративно)
-	void insert(const T& key) override {		
-		
-		if (insert_impl(key)) ++node_count;		
-	};
-	
-	//поиск элемента
-	bool contains(const T& key) const override {
-		// Ранний выход для пустого дерева
-		if (!root) return false;
+	//вставка (итеративно). Возвращает указатель на ключ в дереве и true,
+	//если ключ добавлен, или указатель на уже имевшийся ключ и false
+	std::pair<const T*, bool> insert(const T& key) {
+		return insert_key(key);
+	}
 
+	//вставка перемещением: тяжёлый ключ не копируется
+	std::pair<const T*, bool> insert(T&& key) {
+		return insert_key(std::move(key));
+	}
+	
+	//поиск элемента: одно трёхстороннее сравнение на уровень. K - сам T или
+	//сравнимый с ним тип запроса (std::string_view для строк), T не строится
+	template<typename K = T> requires LookupKey<K, T>
+	bool contains(const K& key) const {
 		const Node* current = root.get();
 
-		if (key == current->key) return true;
-
 		while (current) {
-			if (key < current->key) {
+			const auto order = compare_keys(key, current->key);
+			if (order < 0) {
 				current = current->left.get();
 			}
-			else if (key > current->key) {
+			else if (order > 0) {
 				current = current->right.get();
 			}
 			else {
@@ -102,9 +125,21 @@ public:
 		}
 		return false;
 	};
+
+	//поиск от пальца: подъём от ключа прошлой операции до общего поддерева
+	//и спуск оттуда. Для близких друг к другу ключей O(1) вместо O(глубины)
+	bool contains_near(const T& key) {
+		return finger.seek(root, key) != nullptr;
+	}
+
+	//пакетный поиск: out[i] = contains(keys[i]). Спуски идут группой по
+	//LOOKUP_GROUP с предвыборкой узлов, и промахи кэша перекрываются
+	void contains_many(std::span<const T> keys, std::span<bool> out) const {
+		contains_many_in(root.get(), keys, out);
+	}
 	
 	//удаление элемента
-	void remove(const T& key) override {
+	void remove(const T& key) {
 		if (!root) return;
 
 		// Стек указателей на unique_ptr вдоль пути поиска
@@ -122,254 +157,92 @@ public:
 				return;
 			}
 
-			if (key < current->key) {				
+			const auto order = compare_keys(key, current->key);
+			if (order < 0) {				
 				path.push(&((*current_ptr)->left));
 			}
-			else if (key > current->key) {				
+			else if (order > 0) {				
 				path.push(&((*current_ptr)->right));
 			}
 			else {
 				// Нашли узел для удаления
 				remove_node(path);
 				--node_count;
+				shape_changed();
 				return;
 			}
 		}
 	}
 	
-	//очистка дерева (итеративно)
-	void clear() override {
-		if (!root) return;
-
-		std::stack<std::unique_ptr<Node>> node_stack;
-		node_stack.push(std::move(root));  // Перемещаем владение в стек
-
-		while (!node_stack.empty()) {
-			auto node = std::move(node_stack.top());
-			node_stack.pop();
-
-			// Перемещаем детей в стек перед удалением node
-			if (node->left) {
-				node_stack.push(std::move(node->left));
-			}
-			if (node->right) {
-				node_stack.push(std::move(node->right));
-			}
-		}
-
-		node_count = 0;		
-	}
-
-	//--------- Состояние -------//
-	//проверка на пустоту
-	bool empty() const override{
-		return !root;
-	};
-	
-	// --------- Публичные методы обходов --------- //
-	std::vector<T> inorder() const override {
-		std::vector<T> result;
-		if (root) {
-			result.reserve(node_count);
-			inorder_impl([&](const T& key) { result.emplace_back(key); });
-		}
-		return result;
+	//--------- Массовое построение -------//
+	//построение идеально сбалансированного дерева из строго возрастающих ключей за O(n);
+	//прежнее содержимое заменяется
+	template<std::ranges::input_range Range>
+		requires std::convertible_to<std::ranges::range_reference_t<Range>, T>
+	void build_from_sorted(Range&& keys) {
+		auto nodes = make_sorted_nodes(keys);  // при ошибке дерево не меняется
+
+		this->clear();
+		node_count = nodes.size();
+		root = build_balanced(nodes, 0, nodes.size());
+		shape_changed();
 	}
 
-	std::vector<T> preorder() const override {
-		std::vector<T> result;
-		if (root) {
-			result.reserve(node_count);
-			preorder_impl([&](const T& key) { result.emplace_back(key); });
-		}
-		return result;
-	}
-
-	std::vector<T> postorder() const override {
-		std::vector<T> result;
-		if (root) {
-			result.reserve(node_count);
-			postorder_impl([&](const T& key) { result.emplace_back(key); });
-		}
-		return result;
-	}
-
-	std::vector<T> level_order() const override {
-		std::vector<T> result;
-		if (root) {
-			result.reserve(node_count);
-			level_order_impl([&](const T& key) { result.emplace_back(key); });
-		}
-		return result;
-	}
+	//--------- Итераторы -------//
+	//begin()/end() - в TreeBase (см. TreeIterator.h)
+	using iterator = TreeIterator<Node>;
+	using const_iterator = iterator;
 
-	// --------- Visitor методы  --------- //	
-	void visit_inorder(std::function<void(const T&)> visitor) const override {
-		if (visitor) inorder_impl(visitor);
-	}
-	void visit_preorder(std::function<void(const T&)> visitor) const  override {
-		if (visitor) preorder_impl(visitor);
-	}
-	void visit_postorder(std::function<void(const T&)> visitor) const override {
-		if (visitor) postorder_impl(visitor);
-	}
-	void visit_level_order(std::function<void(const T&)> visitor) const override {
-		if (visitor) level_order_impl(visitor);
-	}
-	
 	//--------- Метрики -------//
-	//размер
-	size_t size() const override {
-		return node_count;
-	};
-	
-	//высота	
-	int height() const override {
-		
-		if (!root) return -1;  
-		std::queue<const Node*> q;
-		q.push(root.get());
-		int height = -1;
-
-		while (!q.empty()) {
-			int levelSize = q.size();
-			height++;
-
-			for (int i = 0; i < levelSize; i++) {
-				const Node* current = q.front();
-				q.pop();
-
-				if (current->left) q.push(current->left.get());
-				if (current->right) q.push(current->right.get());
-			}
-		}
-		return height;
+	//высота (кэшируется до следующего изменения формы)
+	int height() const {
+		return height_cache.get([this] { return subtree_height(root.get()); });
 	}
 
-	//--------- Печать -------//
-	void print(std::ostream& os = std::cout) const override{
-	
-		if (!root) {
-			os << "[empty]\n";
-			return;
-		}
-
-		std::queue<const Node*> q;
-		q.push(root.get());
-		int level = 0;
-
-		while (!q.empty()) {
-			int level_size = q.size();
-			os << "Level " << level << ": ";
-
-			for (int i = 0; i < level_size; ++i) {
-				const Node* current = q.front();
-				q.pop();
 
-				os << current->key;
-
-				// Показываем связи
-				if (current->left || current->right) {
-					os << "[";
-					if (current->left) os << "L:" << current->left->key;
-					if (current->left && current->right) os << ",";
-					if (current->right) os << "R:" << current->right->key;
-					os << "]";
-				}
-				os << "  ";
-
-				if (current->left) q.push(current->left.get());
-				if (current->right) q.push(current->right.get());
-			}
-			os << "\n";
-			level++;
-		}
-	}
-	
-	
 protected:
-	// --------- Шаблонные реализации обходов --------- //
-	template<typename Action>
-	void inorder_impl(Action&& action) const {
-		if (!root) return;
-
-		std::stack<const Node*> stack;
-		const Node* current = root.get();
-
-		while (current || !stack.empty()) {
-			while (current) {
-				stack.push(current);
-				current = current->left.get();
-			}
-
-			current = stack.top();
-			stack.pop();
-			action(current->key);  // Вызываем action
-
-			current = current->right.get();
-		}
+	// --------- Хуки TreeBase --------- //
+	//после clear() форма дерева изменилась
+	void on_clear() {
+		shape_changed();
 	}
 
-	template<typename Action>
-	void preorder_impl(Action&& action) const {
-		if (!root) return;
-
-		std::stack<const Node*> stack;
-		stack.push(root.get());
-
-		while (!stack.empty()) {
-			const Node* current = stack.top();
-			stack.pop();
-			action(current->key);
-
-			if (current->right) stack.push(current->right.get());
-			if (current->left) stack.push(current->left.get());
-		}
+	//форма изменилась в обход пальца: высоту пересчитать, путь забыть
+	void shape_changed() {
+		height_cache.invalidate();
+		finger.reset();
 	}
 
-	template<typename Action>
-	void postorder_impl(Action&& action) const {
-		if (!root) return;
-
-		// Два стека
-		std::stack<const Node*> stack1, stack2;
-		stack1.push(root.get());
-
-		while (!stack1.empty()) {
-			const Node* current = stack1.top();
-			stack1.pop();
-			stack2.push(current);
-
-			if (current->left) stack1.push(current->left.get());
-			if (current->right) stack1.push(current->right.get());
+	//узлы для строго возрастающей последовательности ключей (один проход выделения)
+	template<typename Range>
+	static std::vector<std::unique_ptr<Node>> make_sorted_nodes(Range&& keys) {
+		std::vector<std::unique_ptr<Node>> nodes;
+		if constexpr (std::ranges::sized_range<Range>) {
+			nodes.reserve(std::ranges::size(keys));
 		}
 
-		while (!stack2.empty()) {
-			action(stack2.top()->key);
-			stack2.pop();
+		for (auto&& key : keys) {
+			auto node = std::make_unique<Node>(key);
+			if (!nodes.empty() && !(nodes.back()->key < node->key)) {
+				throw std::invalid_argument(
+					"build_from_sorted requires strictly increasing keys");
+			}
+			nodes.push_back(std::move(node));
 		}
+		return nodes;
 	}
 
-	template<typename Action>
-	void level_order_impl(Action&& action) const {
-		if (!root) return;
-
-		std::vector<const Node*> current_lvl;
-		current_lvl.push_back(root.get());
-
-		while (!current_lvl.empty()) {
-			std::vector<const Node*> next_lvl;
-			next_lvl.reserve(current_lvl.size() * 2);  // Оптимизация!
-
-			for (const Node* node : current_lvl) {
-				action(node->key);
+	// Сборка сбалансированного дерева из узлов [lo, hi) (глубина рекурсии O(log n))
+	static std::unique_ptr<Node> build_balanced(
+		std::vector<std::unique_ptr<Node>>& nodes, size_t lo, size_t hi) {
 
-				if (node->left) next_lvl.push_back(node->left.get());
-				if (node->right) next_lvl.push_back(node->right.get());
-			}
+		if (lo >= hi) return nullptr;
 
-			current_lvl = std::move(next_lvl);
-		}
+		size_t mid = lo + (hi - lo) / 2;
+		auto node = std::move(nodes[mid]);
+		node->left = build_balanced(nodes, lo, mid);
+		node->right = build_balanced(nodes, mid + 1, hi);
+		return node;
 	}
 
 	//-------------- Общие служебные функции ---------//
@@ -410,33 +283,25 @@ protected:
 		return new_root;
 	}
 
-	//служебная функция для добавления узла (итеративная)
-	bool insert_impl(const T& key) {
-		if (!root) {
-			root = std::make_unique<Node>(key);			
-			return true;
-		}
+	//служебная функция для добавления узла (итеративная): спуск начинается
+	//от пальца, поэтому ключ правее максимума встаёт за O(1),
+	//и один на вставку-если-нет: ключ перемещается в узел только после спуска
+	template<typename K>
+	std::pair<const T*, bool> insert_impl(K&& key) {
+		std::unique_ptr<Node>& slot = finger.seek(root, key);
+		if (slot) return { &slot->key, false };  // Дубликат
+
+		slot = std::make_unique<Node>(std::forward<K>(key));
+		height_cache.leaf_inserted(static_cast<int>(finger.depth()));
+		return { &slot->key, true };
+	}
 
-		Node* current = root.get();
-		while (true) {
-			if (key < current->key) {
-				if (!current->left) {
-					current->left = std::make_unique<Node>(key);					
-					return true;
-				}
-				current = current->left.get();
-			}
-			else if (key > current->key) {
-				if (!current->right) {
-					current->right = std::make_unique<Node>(key);					
-					return true;
-				}
-				current = current->right.get();
-			}
-			else {
-				return false;
-			}
-		}
+	//вставка с учётом размера - общая часть insert(const T&) и insert(T&&)
+	template<typename K>
+	std::pair<const T*, bool> insert_key(K&& key) {
+		auto result = insert_impl(std::forward<K>(key));
+		if (result.second) ++node_count;
+		return result;
 	}
 
 	//служебная функция удаления узла
@@ -498,4 +363,6 @@ protected:
 protected:
 	std::unique_ptr<Node> root = nullptr;
 	size_t node_count = 0;
+	HeightCache height_cache;  // высота, пересчитываемая после изменения формы
+	TreeFinger<Node> finger;   // путь к узлу последней вставки или contains_near
 };
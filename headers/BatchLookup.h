@@ -0,0 +1,175 @@
+﻿#pragma once
+#include <array>
+#include <span>
+#include <cstddef>
+#include <stdexcept>
+#include "TreeShape.h"
+#include "KeyCompare.h"
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
+
+// Пакетный поиск по узлам с полями key/left/right.
+// Одиночный спуск - цепочка зависимых промахов кэша: адрес следующего узла
+// известен только после загрузки текущего. Если вести группу спусков
+// поочерёдно (по одному шагу каждого) и сразу запрашивать предвыборку
+// следующего узла, промахи разных ключей перекрываются во времени.
+
+// Число одновременно идущих спусков: достаточно, чтобы занять буферы
+// промахов L1 (обычно 10-16), и ещё помещается в регистры/L1
+inline constexpr size_t LOOKUP_GROUP = 16;
+
+// Подсказка процессору загрузить узел в кэш; без поддержки - ничего не делает
+inline void prefetch_node(const void* address) {
+#if defined(__GNUC__) || defined(__clang__)
+	__builtin_prefetch(address);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	_mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#else
+	(void)address;
+#endif
+}
+
+// out[i] = есть ли keys[i] в дереве. Завершившийся спуск сразу
+// заменяется следующим ключом, так что группа остаётся полной
+template<typename Node, typename T>
+void contains_many_in(const Node* root, std::span<const T> keys, std::span<bool> out) {
+	if (out.size() < keys.size()) {
+		throw std::invalid_argument("contains_many requires out.size() >= keys.size()");
+	}
+	if (!root) {
+		for (size_t i = 0; i < keys.size(); ++i) out[i] = false;
+		return;
+	}
+
+	std::array<const Node*, LOOKUP_GROUP> cursor;  // текущий узел спуска
+	std::array<size_t, LOOKUP_GROUP> slot_key;     // индекс его ключа в keys
+	size_t active = 0;
+	size_t next = 0;
+
+	for (; active < LOOKUP_GROUP && next < keys.size(); ++active, ++next) {
+		cursor[active] = root;
+		slot_key[active] = next;
+	}
+
+	while (active > 0) {
+		for (size_t i = 0; i < active;) {
+			const Node* node = cursor[i];
+			const T& key = keys[slot_key[i]];
+
+			bool found = false;
+			const auto order = compare_keys(key, node->key);
+			if (order < 0) {
+				node = node->left.get();
+			}
+			else if (order > 0) {
+				node = node->right.get();
+			}
+			else {
+				found = true;
+			}
+
+			if (!found && node) {
+				// Шаг сделан; пока узел грузится, идут шаги остальных спусков
+				prefetch_node(node);
+				cursor[i++] = node;
+				continue;
+			}
+
+			out[slot_key[i]] = found;
+			if (next < keys.size()) {
+				cursor[i] = root;
+				slot_key[i] = next++;
+				++i;
+			}
+			else {
+				// Ключи кончились - сжимаем группу, слот i занимает последний
+				--active;
+				cursor[i] = cursor[active];
+				slot_key[i] = slot_key[active];
+			}
+		}
+	}
+}
+
+// Обход отсортированного пакета за один проход по дереву. Путь от корня
+// хранится в стеке вместе с верхней границей поддерева каждого узла (ключом
+// предка, от которого спуск ушёл влево). Для следующего ключа снимаются
+// только узлы, чьё поддерево он уже перерос, и спуск продолжается оттуда:
+// общий префикс путей соседних ключей не проходится заново, и пакет из
+// m ключей стоит O(m log(n/m)) сравнений вместо O(m log n).
+// emit(i, lb) получает lower_bound(keys[i]) - указатель на первый ключ
+// >= keys[i] или nullptr.
+template<typename Node, typename T, typename Emit>
+void sorted_batch_walk(const Node* root, std::span<const T> keys, Emit&& emit) {
+	struct Frame {
+		const Node* node;
+		const T* upper;  // все ключи поддерева меньше *upper (nullptr - без границы)
+	};
+
+	InlineStack<Frame> path;
+	if (root) path.push({ root, nullptr });
+
+	for (size_t i = 0; i < keys.size(); ++i) {
+		const T& key = keys[i];
+		if (i > 0 && key < keys[i - 1]) {
+			throw std::invalid_argument("sorted batch lookup requires keys in ascending order");
+		}
+		if (path.empty()) {
+			emit(i, static_cast<const T*>(nullptr));
+			continue;
+		}
+
+		// Поднимаемся, пока key не попадёт в поддерево; корень не снимается
+		while (path.size() > 1 && path.top().upper && !(key < *path.top().upper)) {
+			path.pop();
+		}
+
+		Frame frame = path.top();
+		const T* result = frame.upper;
+		const Node* node = frame.node;
+		while (true) {
+			Frame next{ nullptr, frame.upper };
+			const auto order = compare_keys(key, node->key);
+			if (order < 0) {
+				result = &node->key;
+				next = { node->left.get(), &node->key };
+			}
+			else if (order > 0) {
+				next.node = node->right.get();
+			}
+			else {
+				result = &node->key;
+				break;
+			}
+
+			if (!next.node) break;
+			path.push(next);
+			frame = next;
+			node = next.node;
+		}
+		emit(i, result);
+	}
+}
+
+// out[i] = есть ли keys[i] в дереве; keys отсортированы по возрастанию
+template<typename Node, typename T>
+void contains_sorted_in(const Node* root, std::span<const T> keys, std::span<bool> out) {
+	if (out.size() < keys.size()) {
+		throw std::invalid_argument("contains_sorted_batch requires out.size() >= keys.size()");
+	}
+	sorted_batch_walk(root, keys, [&](size_t i, const T* lb) {
+		out[i] = lb && !(keys[i] < *lb);
+	});
+}
+
+// out[i] = lower_bound(keys[i]); keys отсортированы по возрастанию
+template<typename Node, typename T>
+void lower_bound_sorted_in(const Node* root, std::span<const T> keys, std::span<const T*> out) {
+	if (out.size() < keys.size()) {
+		throw std::invalid_argument("lower_bound_batch requires out.size() >= keys.size()");
+	}
+	sorted_batch_walk(root, keys, [&](size_t i, const T* lb) {
+		out[i] = lb;
+	});
+}
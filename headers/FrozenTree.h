@@ -0,0 +1,282 @@
+﻿#pragma once
+#include <concepts>
+#include <vector>
+#include <array>
+#include <span>
+#include <ranges>
+#include <bit>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <stdexcept>
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+/**
+ * Неизменяемый снимок множества ключей для пакетного поиска.
+ *
+ * Ключи хранятся в неявной раскладке Эйтцингера (BFS-порядок, корень в [1],
+ * дети узла i - в 2i и 2i+1), дополненной до совершенного дерева глубины depth
+ * копиями максимального ключа. Поэтому любой спуск - ровно depth шагов
+ * i = 2i + (layout[i] < key) без ветвлений, а номер листа после спуска
+ * равен числу ключей меньше key (позиция lower_bound).
+ *
+ * contains_many ведёт спуски пачками: при сборке с AVX-512 в векторе 16 ключей
+ * int32 (8 для int64), с AVX2 - 8 (4); сравнения векторные, узлы читаются
+ * gather, за шаг идут два вектора. Без SIMD и для прочих типов ключей -
+ * скалярно группами по 16. В обоих случаях промахи кэша соседних ключей
+ * перекрываются.
+ * Набор инструкций выбирается при компиляции (-mavx2, -mavx512f, /arch:AVX2).
+ */
+template <std::totally_ordered T>
+class FrozenTree {
+public:
+	//--------- Построение -------//
+	FrozenTree() = default;
+
+	//снимок строго возрастающей последовательности - например, любого
+	//дерева библиотеки (деревья - диапазоны ключей по возрастанию)
+	template<std::ranges::input_range Range>
+		requires std::convertible_to<std::ranges::range_reference_t<Range>, T>
+	explicit FrozenTree(Range&& keys) {
+		std::vector<T> sorted;
+		if constexpr (std::ranges::sized_range<Range>) {
+			sorted.reserve(std::ranges::size(keys));
+		}
+		for (auto&& key : keys) {
+			if (!sorted.empty() && !(sorted.back() < key)) {
+				throw std::invalid_argument("FrozenTree requires strictly increasing keys");
+			}
+			sorted.emplace_back(key);
+		}
+		build(sorted);
+	}
+
+	//--------- Состояние -------//
+	bool empty() const {
+		return key_count == 0;
+	}
+
+	size_t size() const {
+		return key_count;
+	}
+
+	//высота совершенного дерева раскладки (-1 для пустого)
+	int height() const {
+		return static_cast<int>(depth) - 1;
+	}
+
+	//--------- Поиск -------//
+	bool contains(const T& key) const {
+		return key_count != 0 && found(key, descend(key));
+	}
+
+	//первый ключ >= key или nullptr
+	const T* lower_bound(const T& key) const {
+		if (key_count == 0) return nullptr;
+
+		size_t leaf = descend(key);
+		if (leaf - (size_t(1) << depth) >= key_count) return nullptr;
+		return &layout[slot_of(leaf)];
+	}
+
+	//out[i] = contains(keys[i]); пачки по SIMD_LANES ключей, остаток - скалярно
+	void contains_many(std::span<const T> keys, std::span<bool> out) const {
+		if (out.size() < keys.size()) {
+			throw std::invalid_argument("contains_many requires out.size() >= keys.size()");
+		}
+		if (key_count == 0) {
+			for (size_t i = 0; i < keys.size(); ++i) out[i] = false;
+			return;
+		}
+
+		size_t i = 0;
+		if constexpr (SIMD_LANES > 0) {
+			if (depth <= MAX_SIMD_DEPTH) {
+				std::array<size_t, SIMD_LANES> leaves;
+				for (; i + SIMD_LANES <= keys.size(); i += SIMD_LANES) {
+					descend_simd(keys.data() + i, leaves);
+					for (size_t lane = 0; lane < SIMD_LANES; ++lane) {
+						out[i + lane] = found(keys[i + lane], leaves[lane]);
+					}
+				}
+			}
+		}
+
+		std::array<size_t, SCALAR_GROUP> leaves;
+		for (; i < keys.size(); i += SCALAR_GROUP) {
+			size_t count = std::min(SCALAR_GROUP, keys.size() - i);
+			descend_group(keys.data() + i, count, leaves);
+			for (size_t lane = 0; lane < count; ++lane) {
+				out[i + lane] = found(keys[i + lane], leaves[lane]);
+			}
+		}
+	}
+
+private:
+	// Ключи, для которых есть векторный путь: знаковые 32- и 64-битные целые
+	static constexpr bool SIMD_KEY32 = std::signed_integral<T> && sizeof(T) == 4;
+	static constexpr bool SIMD_KEY64 = std::signed_integral<T> && sizeof(T) == 8;
+
+	// Векторов за шаг спуска и ключей в векторе
+	static constexpr size_t SIMD_VECTORS = 2;
+#if defined(__AVX512F__)
+	static constexpr size_t SIMD_WIDTH = SIMD_KEY32 ? 16 : SIMD_KEY64 ? 8 : 0;
+#elif defined(__AVX2__)
+	static constexpr size_t SIMD_WIDTH = SIMD_KEY32 ? 8 : SIMD_KEY64 ? 4 : 0;
+#else
+	static constexpr size_t SIMD_WIDTH = 0;
+#endif
+	static constexpr size_t SIMD_LANES = SIMD_VECTORS * SIMD_WIDTH;
+
+	// Индексы gather - 32-битные со знаком: номер листа < 2^(depth+1)
+	static constexpr size_t MAX_SIMD_DEPTH = 30;
+	static constexpr size_t SCALAR_GROUP = 16;
+
+	void build(const std::vector<T>& sorted) {
+		key_count = sorted.size();
+		layout.clear();
+		depth = 0;
+		if (sorted.empty()) return;
+
+		depth = static_cast<size_t>(std::bit_width(key_count));  // 2^depth - 1 >= n
+		size_t slots = (size_t(1) << depth) - 1;
+
+		// Позиции >= n заполняются максимальным ключом: порядок не нарушается,
+		// а lower_bound для существующего ключа остаётся на настоящей копии
+		layout.assign(slots + 1, sorted.back());
+		for (size_t rank = 0; rank < key_count; ++rank) {
+			layout[slot_of_rank(rank)] = sorted[rank];
+		}
+	}
+
+	// Узел раскладки для позиции rank в отсортированном порядке
+	size_t slot_of_rank(size_t rank) const {
+		size_t position = rank + 1;
+		int zeros = std::countr_zero(position);
+		return (position >> (zeros + 1)) + (size_t(1) << (depth - 1 - zeros));
+	}
+
+	// Узел с lower_bound по листу спуска (0 - все ключи меньше)
+	static size_t slot_of(size_t leaf) {
+		return leaf >> (std::countr_one(leaf) + 1);
+	}
+
+	// Лист после depth шагов; leaf - 2^depth = число ключей < key
+	size_t descend(const T& key) const {
+		size_t index = 1;
+		for (size_t level = 0; level < depth; ++level) {
+			index = 2 * index + (layout[index] < key);
+		}
+		return index;
+	}
+
+	bool found(const T& key, size_t leaf) const {
+		if (leaf - (size_t(1) << depth) >= key_count) return false;
+		return !(key < layout[slot_of(leaf)]);
+	}
+
+	// Скалярные спуски группой: шаги разных ключей независимы и
+	// выполняются процессором параллельно
+	void descend_group(const T* keys, size_t count, std::array<size_t, SCALAR_GROUP>& leaves) const {
+		for (size_t lane = 0; lane < count; ++lane) leaves[lane] = 1;
+		for (size_t level = 0; level < depth; ++level) {
+			for (size_t lane = 0; lane < count; ++lane) {
+				leaves[lane] = 2 * leaves[lane] + (layout[leaves[lane]] < keys[lane]);
+			}
+		}
+	}
+
+	// Векторный спуск SIMD_LANES ключей: gather узлов, сравнение,
+	// index = 2 * index + (узел < key). Два независимых вектора за шаг,
+	// чтобы задержки их gather перекрывались
+	void descend_simd(const T* keys, std::array<size_t, SIMD_LANES>& leaves) const {
+		std::array<int64_t, SIMD_LANES> lanes;
+#if defined(__AVX512F__)
+		if constexpr (SIMD_KEY32) {
+			const __m512i one = _mm512_set1_epi32(1);
+			__m512i key[SIMD_VECTORS], index[SIMD_VECTORS];
+			for (size_t v = 0; v < SIMD_VECTORS; ++v) {
+				key[v] = _mm512_loadu_si512(keys + v * SIMD_WIDTH);
+				index[v] = one;
+			}
+			for (size_t level = 0; level < depth; ++level) {
+				for (size_t v = 0; v < SIMD_VECTORS; ++v) {
+					__m512i node = _mm512_i32gather_epi32(index[v], layout.data(), 4);
+					__mmask16 less = _mm512_cmpgt_epi32_mask(key[v], node);
+					__m512i twice = _mm512_add_epi32(index[v], index[v]);
+					index[v] = _mm512_mask_add_epi32(twice, less, twice, one);
+				}
+			}
+			alignas(64) std::array<int32_t, SIMD_LANES> narrow;
+			for (size_t v = 0; v < SIMD_VECTORS; ++v) _mm512_store_si512(narrow.data() + v * SIMD_WIDTH, index[v]);
+			std::copy(narrow.begin(), narrow.end(), lanes.begin());
+		}
+		else if constexpr (SIMD_KEY64) {
+			const __m512i one = _mm512_set1_epi64(1);
+			__m512i key[SIMD_VECTORS], index[SIMD_VECTORS];
+			for (size_t v = 0; v < SIMD_VECTORS; ++v) {
+				key[v] = _mm512_loadu_si512(keys + v * SIMD_WIDTH);
+				index[v] = one;
+			}
+			for (size_t level = 0; level < depth; ++level) {
+				for (size_t v = 0; v < SIMD_VECTORS; ++v) {
+					__m512i node = _mm512_i64gather_epi64(index[v], layout.data(), 8);
+					__mmask8 less = _mm512_cmpgt_epi64_mask(key[v], node);
+					__m512i twice = _mm512_add_epi64(index[v], index[v]);
+					index[v] = _mm512_mask_add_epi64(twice, less, twice, one);
+				}
+			}
+			for (size_t v = 0; v < SIMD_VECTORS; ++v) _mm512_storeu_si512(lanes.data() + v * SIMD_WIDTH, index[v]);
+		}
+#elif defined(__AVX2__)
+		if constexpr (SIMD_KEY32) {
+			const int* base = reinterpret_cast<const int*>(layout.data());
+			__m256i key[SIMD_VECTORS], index[SIMD_VECTORS];
+			for (size_t v = 0; v < SIMD_VECTORS; ++v) {
+				key[v] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + v * SIMD_WIDTH));
+				index[v] = _mm256_set1_epi32(1);
+			}
+			for (size_t level = 0; level < depth; ++level) {
+				for (size_t v = 0; v < SIMD_VECTORS; ++v) {
+					__m256i node = _mm256_i32gather_epi32(base, index[v], 4);
+					__m256i less = _mm256_cmpgt_epi32(key[v], node);  // -1 там, где узел < key
+					index[v] = _mm256_sub_epi32(_mm256_add_epi32(index[v], index[v]), less);
+				}
+			}
+			alignas(32) std::array<int32_t, SIMD_LANES> narrow;
+			for (size_t v = 0; v < SIMD_VECTORS; ++v) {
+				_mm256_store_si256(reinterpret_cast<__m256i*>(narrow.data() + v * SIMD_WIDTH), index[v]);
+			}
+			std::copy(narrow.begin(), narrow.end(), lanes.begin());
+		}
+		else if constexpr (SIMD_KEY64) {
+			const long long* base = reinterpret_cast<const long long*>(layout.data());
+			__m256i key[SIMD_VECTORS], index[SIMD_VECTORS];
+			for (size_t v = 0; v < SIMD_VECTORS; ++v) {
+				key[v] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + v * SIMD_WIDTH));
+				index[v] = _mm256_set1_epi64x(1);
+			}
+			for (size_t level = 0; level < depth; ++level) {
+				for (size_t v = 0; v < SIMD_VECTORS; ++v) {
+					__m256i node = _mm256_i64gather_epi64(base, index[v], 8);
+					__m256i less = _mm256_cmpgt_epi64(key[v], node);
+					index[v] = _mm256_sub_epi64(_mm256_add_epi64(index[v], index[v]), less);
+				}
+			}
+			for (size_t v = 0; v < SIMD_VECTORS; ++v) {
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes.data() + v * SIMD_WIDTH), index[v]);
+			}
+		}
+#else
+		(void)keys;
+#endif
+		for (size_t lane = 0; lane < SIMD_LANES; ++lane) leaves[lane] = static_cast<size_t>(lanes[lane]);
+	}
+
+private:
+	std::vector<T> layout;  // [0] не используется, узлы 1 .. 2^depth - 1
+	size_t key_count = 0;
+	size_t depth = 0;       // число уровней совершенного дерева
+};
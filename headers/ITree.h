@@ -2,15 +2,23 @@
 #include <concepts>
 #include <vector>
 #include <functional>
+#include <ostream>
+#include <utility>
+#include "SearchTree.h"
 
 
+// Необязательный type-erased интерфейс: сами деревья от него не наследуются
+// (см. SearchTree.h и TreeBase.h), а подключаются через TreeAdapter, когда
+// нужен общий указатель на деревья разных типов.
 template <std::totally_ordered T>
 class ITree {
 public:
     virtual ~ITree() = default;
 
-    // Основные операции
-    virtual void insert(const T& key) = 0;
+    // Основные операции; insert возвращает указатель на ключ в дереве
+    // и true, если ключ добавлен
+    virtual std::pair<const T*, bool> insert(const T& key) = 0;
+    virtual std::pair<const T*, bool> insert(T&& key) = 0;
     virtual bool contains(const T& key) const = 0;
     virtual void remove(const T& key) = 0;
     virtual void clear() = 0;
@@ -31,6 +39,13 @@ public:
     virtual void visit_postorder(std::function<void(const T&)> visitor) const = 0;
     virtual void visit_level_order(std::function<void(const T&)> visitor) const = 0;
 
+    // Упорядоченная навигация (nullptr, если ключа нет)
+    virtual const T* lower_bound(const T& key) const = 0;   // первый >= key
+    virtual const T* upper_bound(const T& key) const = 0;   // первый > key
+    virtual const T* floor(const T& key) const = 0;         // последний <= key
+    virtual const T* ceiling(const T& key) const = 0;       // первый >= key
+    virtual void visit_range(const T& lo, const T& hi, std::function<void(const T&)> visitor) const = 0;  // [lo, hi)
+
     // Характеристики
     virtual int height() const = 0;   
 
@@ -42,4 +57,61 @@ template <std::totally_ordered T>
 std::ostream& operator<<(std::ostream& os, const ITree<T>& tree) {
     tree.print(os);
     return os;
-}
\ No newline at end of file
+}
+
+// Конкретное дерево за виртуальным интерфейсом ITree; само дерево доступно
+// через get() для статических вызовов
+template <typename Tree>
+    requires SearchTree<Tree, typename Tree::key_type>
+class TreeAdapter final : public ITree<typename Tree::key_type> {
+    using T = typename Tree::key_type;
+
+public:
+    TreeAdapter() = default;
+    explicit TreeAdapter(Tree tree) : tree(std::move(tree)) {}
+
+    Tree& get() { return tree; }
+    const Tree& get() const { return tree; }
+
+    std::pair<const T*, bool> insert(const T& key) override { return tree.insert(key); }
+    std::pair<const T*, bool> insert(T&& key) override { return tree.insert(std::move(key)); }
+    bool contains(const T& key) const override { return tree.contains(key); }
+    void remove(const T& key) override { tree.remove(key); }
+    void clear() override { tree.clear(); }
+
+    bool empty() const override { return tree.empty(); }
+    size_t size() const override { return tree.size(); }
+
+    std::vector<T> inorder() const override { return tree.inorder(); }
+    std::vector<T> preorder() const override { return tree.preorder(); }
+    std::vector<T> postorder() const override { return tree.postorder(); }
+    std::vector<T> level_order() const override { return tree.level_order(); }
+
+    void visit_inorder(std::function<void(const T&)> visitor) const override {
+        if (visitor) tree.visit_inorder(visitor);
+    }
+    void visit_preorder(std::function<void(const T&)> visitor) const override {
+        if (visitor) tree.visit_preorder(visitor);
+    }
+    void visit_postorder(std::function<void(const T&)> visitor) const override {
+        if (visitor) tree.visit_postorder(visitor);
+    }
+    void visit_level_order(std::function<void(const T&)> visitor) const override {
+        if (visitor) tree.visit_level_order(visitor);
+    }
+
+    const T* lower_bound(const T& key) const override { return tree.lower_bound(key); }
+    const T* upper_bound(const T& key) const override { return tree.upper_bound(key); }
+    const T* floor(const T& key) const override { return tree.floor(key); }
+    const T* ceiling(const T& key) const override { return tree.ceiling(key); }
+    void visit_range(const T& lo, const T& hi, std::function<void(const T&)> visitor) const override {
+        if (visitor) tree.visit_range(lo, hi, visitor);
+    }
+
+    int height() const override { return tree.height(); }
+
+    void print(std::ostream& os) const override { tree.print(os); }
+
+private:
+    Tree tree;
+};
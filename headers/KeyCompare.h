@@ -0,0 +1,38 @@
+﻿#pragma once
+#include <compare>
+#include <concepts>
+
+// Трёхстороннее сравнение ключей при спуске по дереву. Пара проверок
+// key < node->key и key > node->key на каждом уровне для std::string или
+// составных ключей дважды проходит по данным; одно сравнение <=> даёт сразу
+// все три исхода.
+
+// Сравнение ключей типа T с ключами и запросами. По умолчанию - operator<=>,
+// если он есть, иначе результат собирается из operator<. Специализация
+// KeyCompare<T> подключает свой трёхсторонний компаратор (например, для
+// ключей без <=>); порядок должен совпадать с operator< типа T.
+template<typename T>
+struct KeyCompare {
+	template<typename A, typename B>
+	constexpr auto operator()(const A& a, const B& b) const {
+		if constexpr (requires { a <=> b; }) {
+			return a <=> b;
+		}
+		else {
+			return a < b ? std::weak_ordering::less
+				: b < a ? std::weak_ordering::greater
+				: std::weak_ordering::equivalent;
+		}
+	}
+};
+
+// Тип запроса для гетерогенного поиска: сравним с ключами T, и T для
+// поиска строить не нужно (std::string_view или const char* для std::string)
+template<typename K, typename T>
+concept LookupKey = std::totally_ordered_with<K, T>;
+
+// Сравнение запроса с ключом узла: результат < 0, == 0 или > 0
+template<typename T, typename K>
+constexpr auto compare_keys(const K& key, const T& node_key) {
+	return KeyCompare<T>{}(key, node_key);
+}
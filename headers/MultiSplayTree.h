@@ -0,0 +1,624 @@
+﻿#pragma once
+#include <iostream>
+#include <memory>
+#include <concepts>
+#include "TreeBase.h"
+#include <stack>
+#include <queue>
+#include <numeric>
+#include <algorithm>
+#include <random>
+#include <cstdint>
+
+/**
+ * Multi-splay дерево (Wang, Derryberry, Sleator).
+ *
+ * Эталонное дерево P разбито на предпочтительные пути, каждый путь хранится
+ * отдельным вспомогательным splay-деревом, а вспомогательные деревья сцеплены
+ * в одно общее бинарное дерево поиска T.
+ *
+ * Роль глубины узла в P играет случайный приоритет: P — декартово дерево по
+ * (key, priority), поэтому его глубина O(log n) в среднем независимо от порядка
+ * вставки, а на любом пути P приоритет строго убывает сверху вниз.
+ * Все оценки вероятностные (по выбору приоритетов): глубина T - O(log² n)
+ * в среднем, find_and_update() - O(log n) амортизированно в среднем и
+ * O(log log n)-конкурентен с оптимальным оффлайн BST. Детерминированного
+ * O(log n) в худшем случае нет: при неудачных приоритетах P, а с ним и T,
+ * может оказаться глубже. Для такой гарантии нужно детерминированно
+ * сбалансированное эталонное дерево.
+ */
+template <std::totally_ordered T>
+class MultiSplayTree : public TreeBase<MultiSplayTree<T>, T> {
+	friend TreeBase<MultiSplayTree, T>;  // root/node_count и хуки для общего кода
+
+public:
+
+	struct Node { //структура для узла
+		T key;
+		std::unique_ptr<Node> left;
+		std::unique_ptr<Node> right;
+		Node* parent;
+		uint64_t priority;      // приоритет в эталонном дереве (больше — ближе к корню P)
+		uint64_t min_priority;  // минимальный приоритет во вспомогательном поддереве
+		bool is_root;           // узел - корень своего вспомогательного дерева
+
+		// Генератор случайных чисел (статический, общий для всех узлов)
+		// 64 бита - чтобы совпадения приоритетов были практически невозможны
+		static uint64_t generate_priority() {
+			static std::mt19937_64 generator(std::random_device{}());
+			return generator();
+		}
+
+		//Конструкторы и присваивание
+		explicit Node(T k)
+			: key(std::move(k)), left(nullptr), right(nullptr), parent(nullptr),
+			priority(generate_priority()), is_root(true) {
+			min_priority = priority;
+		}
+
+		//Копирование
+		Node(const Node&) = delete;
+		Node& operator=(const Node&) = delete;
+
+		//Перемещение
+		Node(Node&& other) noexcept = default;
+		Node& operator=(Node&& other) noexcept = default;
+
+		~Node() = default;
+	};
+
+public:
+	//--------- конструкторы и операторы присваивания -------//
+
+	MultiSplayTree() = default;  // пустое дерево
+
+	MultiSplayTree(T key) : root(std::make_unique<Node>(key)), node_count(1) {};
+
+	// Конструктор копирования
+	MultiSplayTree(const MultiSplayTree& other)
+		: root(clone(other.root.get())), node_count(other.node_count), height_cache(other.height_cache) {};
+
+	// Конструктор перемещения
+	MultiSplayTree(MultiSplayTree&& other) noexcept
+		: root(std::move(other.root)), node_count(other.node_count), height_cache(other.height_cache) {
+		other.root = nullptr;
+		other.node_count = 0;
+		other.height_cache.invalidate();
+	}
+
+	~MultiSplayTree() {
+		this->clear();
+	};
+
+	// Оператор копирующего присваивания
+	MultiSplayTree& operator=(const MultiSplayTree& other) {
+		if (this != &other) {
+			root = clone(other.root.get());
+			node_count = other.node_count;
+			height_cache = other.height_cache;
+		}
+		return *this;
+	};
+
+	// Оператор перемещающего присваивания
+	MultiSplayTree& operator=(MultiSplayTree&& other) noexcept {
+		this->clear();
+		root = std::move(other.root);
+		node_count = other.node_count;
+		height_cache = other.height_cache;
+		other.root = nullptr;
+		other.node_count = 0;
+		other.height_cache.invalidate();
+		return *this;
+	};
+
+	//--------- Основные операции -------//
+	//вставка. Возвращает указатель на ключ в дереве и true, если ключ добавлен
+	std::pair<const T*, bool> insert(const T& key) {
+		return insert_key(key);
+	}
+
+	//вставка перемещением: тяжёлый ключ не копируется
+	std::pair<const T*, bool> insert(T&& key) {
+		return insert_key(std::move(key));
+	}
+
+	//поиск элемента (без перестройки, O(log² n) в среднем по приоритетам);
+	//K - T или сравнимый с ним тип запроса
+	template<typename K = T> requires LookupKey<K, T>
+	bool contains(const K& key) const {
+		return find_node(key) != nullptr;
+	};
+
+	//поиск с перестройкой: путь до ключа становится предпочтительным
+	bool find_and_update(const T& key) {
+		if (!root) return false;
+
+		Node* current = root.get();
+		Node* last = current;
+		while (current) {
+			last = current;
+			const auto order = compare_keys(key, current->key);
+			if (order < 0) {
+				current = current->left.get();
+			}
+			else if (order > 0) {
+				current = current->right.get();
+			}
+			else {
+				break;
+			}
+		}
+		// Как и в SplayTree, при промахе поднимаем ближайший узел
+		access(last);
+		height_cache.invalidate();
+		return last->key == key;
+	}
+
+	//удаление элемента
+	void remove(const T& key) {
+		if (remove_impl(key)) --node_count;
+		height_cache.invalidate();
+	}
+
+	//--------- Итераторы -------//
+	//begin()/end() - в TreeBase (см. TreeIterator.h)
+	using iterator = TreeIterator<Node>;
+	using const_iterator = iterator;
+
+	//--------- Метрики -------//
+	//высота (кэшируется до следующего изменения формы)
+	int height() const {
+		return height_cache.get([this] { return subtree_height(root.get()); });
+	}
+
+
+protected:
+	//======== работа со вспомогательными деревьями =====/
+
+	// Ребёнок принадлежит тому же вспомогательному дереву, что и родитель
+	static bool in_aux(const Node* child) {
+		return child && !child->is_root;
+	}
+
+	// Пересчёт минимального приоритета вспомогательного поддерева
+	static void update(Node* node) {
+		uint64_t min_priority = node->priority;
+		if (in_aux(node->left.get())) {
+			min_priority = std::min(min_priority, node->left->min_priority);
+		}
+		if (in_aux(node->right.get())) {
+			min_priority = std::min(min_priority, node->right->min_priority);
+		}
+		node->min_priority = min_priority;
+	}
+
+	// unique_ptr, которым владеет узел (у родителя или корень)
+	std::unique_ptr<Node>& slot_of(Node* node) {
+		Node* parent = node->parent;
+		if (!parent) return root;
+		return parent->left.get() == node ? parent->left : parent->right;
+	}
+
+	// Поворот x вокруг его родителя (внутри одного вспомогательного дерева)
+	void rotate(Node* x) {
+		Node* p = x->parent;
+		Node* g = p->parent;
+		std::unique_ptr<Node>& p_slot = slot_of(p);
+		std::unique_ptr<Node> p_owner = std::move(p_slot);
+
+		if (p->left.get() == x) {
+			std::unique_ptr<Node> x_owner = std::move(p->left);
+			p->left = std::move(x->right);
+			if (p->left) p->left->parent = p;
+			x->right = std::move(p_owner);
+			p_slot = std::move(x_owner);
+		}
+		else {
+			std::unique_ptr<Node> x_owner = std::move(p->right);
+			p->right = std::move(x->left);
+			if (p->right) p->right->parent = p;
+			x->left = std::move(p_owner);
+			p_slot = std::move(x_owner);
+		}
+
+		p->parent = x;
+		x->parent = g;
+
+		// Корнем вспомогательного дерева становится x
+		x->is_root = p->is_root;
+		p->is_root = false;
+
+		update(p);
+		update(x);
+	}
+
+	// Splay внутри вспомогательного дерева: поднимаем x до его корня
+	// (или до ребёнка узла stop, если он задан)
+	void splay(Node* x, const Node* stop = nullptr) {
+		while (!x->is_root && x->parent != stop) {
+			Node* p = x->parent;
+			if (!p->is_root && p->parent != stop) {
+				Node* g = p->parent;
+				bool zig_zig = (g->left.get() == p) == (p->left.get() == x);
+				rotate(zig_zig ? p : x);
+			}
+			rotate(x);
+		}
+	}
+
+	// Минимальный/максимальный узел вспомогательного поддерева
+	static Node* aux_min(Node* node) {
+		while (in_aux(node->left.get())) node = node->left.get();
+		return node;
+	}
+
+	static Node* aux_max(Node* node) {
+		while (in_aux(node->right.get())) node = node->right.get();
+		return node;
+	}
+
+	// Самый левый/правый узел вспомогательного поддерева с priority < threshold
+	static Node* leftmost_below(Node* node, uint64_t threshold) {
+		while (true) {
+			Node* left = node->left.get();
+			if (in_aux(left) && left->min_priority < threshold) {
+				node = left;
+			}
+			else if (node->priority < threshold) {
+				return node;
+			}
+			else {
+				node = node->right.get();
+			}
+		}
+	}
+
+	static Node* rightmost_below(Node* node, uint64_t threshold) {
+		while (true) {
+			Node* right = node->right.get();
+			if (in_aux(right) && right->min_priority < threshold) {
+				node = right;
+			}
+			else if (node->priority < threshold) {
+				return node;
+			}
+			else {
+				node = node->left.get();
+			}
+		}
+	}
+
+	// Отрезаем от вспомогательного дерева с корнем top нижнюю часть пути
+	// (узлы с priority < threshold) в отдельное вспомогательное дерево.
+	// Такие узлы образуют непрерывный интервал ключей (a, b), поэтому
+	// после splay(a) и splay(b) до ребёнка a они оказываются одним поддеревом.
+	// Возвращает корень отрезанной части или nullptr, если резать нечего.
+	Node* cut_below(Node* top, uint64_t threshold) {
+		if (top->min_priority >= threshold) return nullptr;
+
+		Node* lo = leftmost_below(top, threshold);
+		Node* hi = rightmost_below(top, threshold);
+
+		splay(lo);
+		Node* a = in_aux(lo->left.get()) ? aux_max(lo->left.get()) : nullptr;
+		splay(hi);
+		Node* b = in_aux(hi->right.get()) ? aux_min(hi->right.get()) : nullptr;
+
+		if (!a && !b) {
+			// Весь путь ниже порога - он и так отдельное дерево
+			return hi;
+		}
+
+		Node* deep = nullptr;
+		if (a) {
+			splay(a);
+			if (b) {
+				splay(b, a);
+				deep = b->left.get();
+			}
+			else {
+				deep = a->right.get();
+			}
+		}
+		else {
+			splay(b);
+			deep = b->left.get();
+		}
+
+		deep->is_root = true;
+		if (b) update(b);
+		if (a) update(a);
+		return deep;
+	}
+
+	// Доступ к узлу x: путь от корня P до x становится предпочтительным,
+	// затем x поднимается в корень всего дерева
+	void access(Node* x) {
+		splay(x);
+		Node* y = x;
+
+		while (y->parent) {
+			Node* z = y->parent;
+			bool hangs_left = y->key < z->key;
+			splay(z);
+
+			// Вспомогательное дерево y висит в "щели" между z и его соседом;
+			// родителем вершины пути y в P является более глубокий из них
+			Node* neighbor = nullptr;
+			if (hangs_left) {
+				if (in_aux(z->left.get())) neighbor = aux_max(z->left.get());
+			}
+			else {
+				if (in_aux(z->right.get())) neighbor = aux_min(z->right.get());
+			}
+			Node* w = (neighbor && neighbor->priority < z->priority) ? neighbor : z;
+			if (w != z) splay(w);
+
+			// Переключаем предпочтительного ребёнка w: старое продолжение пути
+			// отрезаем, путь y присоединяем
+			cut_below(w, w->priority);
+			y->is_root = false;
+			for (Node* node = y->parent; node; node = node->parent) {
+				update(node);
+				if (node->is_root) break;
+			}
+
+			splay(w);
+			y = w;
+		}
+
+		splay(x);
+	}
+
+	//вставка с учётом размера - общая часть insert(const T&) и insert(T&&)
+	template<typename K>
+	std::pair<const T*, bool> insert_key(K&& key) {
+		auto result = insert_impl(std::forward<K>(key));
+		if (result.second) ++node_count;
+		height_cache.invalidate();
+		return result;
+	}
+
+	//служебная функция вставки; новый узел оказывается в корне
+	template<typename K>
+	std::pair<const T*, bool> insert_impl(K&& key) {
+		if (!root) {
+			root = std::make_unique<Node>(std::forward<K>(key));
+			return { &root->key, true };
+		}
+
+		// Ищем соседей ключа
+		Node* current = root.get();
+		Node* pred = nullptr;
+		Node* succ = nullptr;
+		while (current) {
+			const auto order = compare_keys(key, current->key);
+			if (order < 0) {
+				succ = current;
+				current = current->left.get();
+			}
+			else if (order > 0) {
+				pred = current;
+				current = current->right.get();
+			}
+			else {
+				access(current);  // Дубликат
+				return { &current->key, false };
+			}
+		}
+
+		// Соседи по ключу связаны в P отношением предок-потомок;
+		// новый ключ попадает в P под более глубокого из них
+		Node* deeper = !pred ? succ
+			: !succ ? pred
+			: (pred->priority < succ->priority ? pred : succ);
+		access(deeper);
+
+		// Оставляем в корневом пути только путь поиска (до deeper включительно)
+		cut_below(deeper, deeper->priority);
+		splay(deeper);
+
+		// Ключ перемещается в узел; дальше сравнения идут с x->key
+		auto node = std::make_unique<Node>(std::forward<K>(key));
+		Node* x = node.get();
+
+		// Часть пути ниже приоритета нового узла уходит под него
+		Node* deep = cut_below(root.get(), x->priority);
+
+		if (!deep) {
+			// Новый узел - лист P: подвешиваем его на свободное место
+			current = root.get();
+			while (true) {
+				std::unique_ptr<Node>& child = x->key < current->key ? current->left : current->right;
+				if (!child) {
+					node->parent = current;
+					child = std::move(node);
+					break;
+				}
+				current = child.get();
+			}
+		}
+		else {
+			std::unique_ptr<Node>& slot = slot_of(deep);
+			Node* parent = deep->parent;
+
+			// Делим отрезанный путь по ключу: меньшие - влево, большие - вправо
+			Node* lower = nullptr;
+			for (Node* n = deep; n; ) {
+				if (n->key < x->key) {
+					lower = n;
+					n = in_aux(n->right.get()) ? n->right.get() : nullptr;
+				}
+				else {
+					n = in_aux(n->left.get()) ? n->left.get() : nullptr;
+				}
+			}
+
+			std::unique_ptr<Node> lesser, greater;
+			if (lower) {
+				splay(lower);
+				greater = std::move(lower->right);
+				if (greater) greater->is_root = true;
+				update(lower);
+				lesser = std::move(slot);
+			}
+			else {
+				greater = std::move(slot);
+			}
+
+			node->left = std::move(lesser);
+			node->right = std::move(greater);
+			if (node->left) node->left->parent = x;
+			if (node->right) node->right->parent = x;
+			node->parent = parent;
+			slot = std::move(node);
+		}
+
+		access(x);
+		return { &x->key, true };
+	}
+
+	//служебная функция удаления
+	bool remove_impl(const T& key) {
+		Node* x = find_node(key);
+		if (!x) return false;
+
+		access(x);
+
+		// Преемник по ключу
+		Node* succ = x->right.get();
+		while (succ && succ->left) succ = succ->left.get();
+
+		if (succ && succ->priority < x->priority) {
+			// Преемник - потомок x в P без левого ребёнка:
+			// переносим его ключ в x и удаляем узел преемника
+			access(succ);
+			T succ_key = std::move(succ->key);
+			detach_root();
+			x->key = std::move(succ_key);
+		}
+		else {
+			// У x в P не более одного ребёнка
+			detach_root();
+		}
+		return true;
+	}
+
+	// Удаление корня, у которого в P не более одного ребёнка
+	void detach_root() {
+		Node* s = root.get();
+
+		// Продолжение пути под s становится отдельным деревом
+		cut_below(s, s->priority);
+		splay(s);
+
+		// Соседи s по его вспомогательному дереву
+		Node* lower = in_aux(s->left.get()) ? aux_max(s->left.get()) : nullptr;
+		Node* upper = in_aux(s->right.get()) ? aux_min(s->right.get()) : nullptr;
+
+		std::unique_ptr<Node> new_root;
+		if (lower && !lower->right) {
+			splay(lower, s);
+			lower->right = std::move(s->right);
+			if (lower->right) lower->right->parent = lower;
+			new_root = std::move(s->left);
+		}
+		else if (upper && !upper->left) {
+			splay(upper, s);
+			upper->left = std::move(s->left);
+			if (upper->left) upper->left->parent = upper;
+			new_root = std::move(s->right);
+		}
+		else {
+			// Непустым может быть только одно поддерево
+			new_root = s->left ? std::move(s->left) : std::move(s->right);
+		}
+
+		if (new_root) {
+			new_root->parent = nullptr;
+			new_root->is_root = true;
+			update(new_root.get());
+		}
+		root = std::move(new_root);
+	}
+
+	//поиск узла без перестройки
+	template<typename K>
+	Node* find_node(const K& key) const {
+		Node* current = root.get();
+		while (current) {
+			const auto order = compare_keys(key, current->key);
+			if (order < 0) {
+				current = current->left.get();
+			}
+			else if (order > 0) {
+				current = current->right.get();
+			}
+			else {
+				return current;
+			}
+		}
+		return nullptr;
+	}
+
+	// --------- Хуки TreeBase --------- //
+	//после clear() форма дерева изменилась
+	void on_clear() {
+		height_cache.invalidate();
+	}
+
+	//-------------- Общие служебные функции ---------//
+
+	// копия узла вместе со служебными полями
+	static std::unique_ptr<Node> copy_node(const Node* source, Node* parent) {
+		auto node = std::make_unique<Node>(source->key);
+		node->priority = source->priority;
+		node->min_priority = source->min_priority;
+		node->is_root = source->is_root;
+		node->parent = parent;
+		return node;
+	}
+
+	//служебная функция копирования дерева (итеративная)
+	static std::unique_ptr<Node> clone(const Node* source_root) {
+
+		if (!source_root) return nullptr;
+
+		auto new_root = copy_node(source_root, nullptr);
+
+		std::queue<const Node*> src;  // Оригинал
+		std::queue<Node*> dst;        // Копия
+
+		src.push(source_root);
+		dst.push(new_root.get());
+
+		while (!src.empty()) {
+			const Node* src_node = src.front();
+			Node* dst_node = dst.front();
+			src.pop();
+			dst.pop();
+
+			// Левый ребенок
+			if (src_node->left) {
+				dst_node->left = copy_node(src_node->left.get(), dst_node);
+				src.push(src_node->left.get());
+				dst.push(dst_node->left.get());
+			}
+
+			// Правый ребенок
+			if (src_node->right) {
+				dst_node->right = copy_node(src_node->right.get(), dst_node);
+				src.push(src_node->right.get());
+				dst.push(dst_node->right.get());
+			}
+		}
+
+		return new_root;
+	}
+
+protected:
+	std::unique_ptr<Node> root = nullptr;
+	size_t node_count = 0;
+	HeightCache height_cache;  // высота, пересчитываемая после изменения формы
+};
@@ -2,12 +2,14 @@
 #include <iostream>
 #include <memory>
 #include <concepts>
-#include "ITree.h"
+#include "TreeBase.h"
+#include "BatchLookup.h"
 #include <numeric>
 #include <algorithm>
 #include <stack>
 #include <queue>
 #include <vector>
+#include <span>
 #include <stdexcept>
 
 
@@ -16,7 +18,8 @@
  * WARNING: Memory usage is O(MaxSize²)
  */
 template <std::totally_ordered T, int MAX_SIZE = 10000>
-class OptimalBST : public ITree<T> {
+class OptimalBST : public TreeBase<OptimalBST<T, MAX_SIZE>, T> {
+    friend TreeBase<OptimalBST, T>;  // root/node_count и хуки для общего кода
 
 protected:
     struct Node {
@@ -87,17 +90,20 @@ public:
 
     // Конструктор копирования
     OptimalBST(const OptimalBST& other)
-        : root(clone(other.root.get())), node_count(other.node_count) {
+        : root(clone(other.root.get())), node_count(other.node_count),
+        tree_height(other.tree_height) {
     }
 
     // Конструктор перемещения
     OptimalBST(OptimalBST&& other) noexcept
-        : root(std::move(other.root)), node_count(other.node_count) {
+        : root(std::move(other.root)), node_count(other.node_count),
+        tree_height(other.tree_height) {
         other.node_count = 0;
+        other.tree_height = -1;
     }
 
-    virtual ~OptimalBST() {
-        clear();
+    ~OptimalBST() {
+        this->clear();
     }
 
     // Оператор копирующего присваивания
@@ -105,6 +111,7 @@ public:
         if (this != &other) {
             root = clone(other.root.get());
             node_count = other.node_count;
+            tree_height = other.tree_height;
         }
         return *this;
     }
@@ -112,30 +119,43 @@ public:
     // Оператор перемещающего присваивания
     OptimalBST& operator=(OptimalBST&& other) noexcept {
         if (this != &other) {
-            clear();
+            this->clear();
             root = std::move(other.root);
             node_count = other.node_count;
+            tree_height = other.tree_height;
             other.node_count = 0;
+            other.tree_height = -1;
         }
         return *this;
     }
 
     //--------- Основные операции -------//
 
-    void insert(const T& key) override {
+    // Дерево статическое: вставка ничего не меняет и возвращает указатель
+    // на уже имеющийся ключ (или nullptr) и false
+    std::pair<const T*, bool> insert(const T& key) {
 #ifdef DEBUG
         std::cerr << "[OptimalBST] Warning: insert() called on static tree. "
             << "Operation ignored.\n";
 #endif
+        const T* found = this->lower_bound(key);
+        return { found && !(key < *found) ? found : nullptr, false };
     }
 
-    bool contains(const T& key) const override {
+    std::pair<const T*, bool> insert(T&& key) {
+        return insert(static_cast<const T&>(key));
+    }
+
+    //поиск; K - T или сравнимый с ним тип запроса
+    template<typename K = T> requires LookupKey<K, T>
+    bool contains(const K& key) const {
         const Node* current = root.get();
         while (current) {
-            if (key < current->key) {
+            const auto order = compare_keys(key, current->key);
+            if (order < 0) {
                 current = current->left.get();
             }
-            else if (key > current->key) {
+            else if (order > 0) {
                 current = current->right.get();
             }
             else {
@@ -145,121 +165,28 @@ public:
         return false;
     }
 
-    void remove(const T& key) override {
+    // Пакетный поиск: out[i] = contains(keys[i]), группа спусков с предвыборкой
+    void contains_many(std::span<const T> keys, std::span<bool> out) const {
+        contains_many_in(root.get(), keys, out);
+    }
+
+    void remove(const T& key) {
 #ifdef DEBUG
         std::cerr << "[OptimalBST] Warning: remove() called on static tree. "
             << "Operation ignored.\n";
 #endif
     }
 
-    void clear() override {
-        if (!root) return;
-
-        std::stack<std::unique_ptr<Node>> node_stack;
-        node_stack.push(std::move(root));
-
-        while (!node_stack.empty()) {
-            auto node = std::move(node_stack.top());
-            node_stack.pop();
-
-            if (node->left) {
-                node_stack.push(std::move(node->left));
-            }
-            if (node->right) {
-                node_stack.push(std::move(node->right));
-            }
-        }
-
-        node_count = 0;
-    }
-
-    //--------- Состояние -------//
-
-    bool empty() const override {
-        return !root;
-    }
-
-    size_t size() const override {
-        return node_count;
-    }
-
-    // --------- Публичные методы обходов --------- //
-
-    std::vector<T> inorder() const override {
-        std::vector<T> result;
-        if (root) {
-            result.reserve(node_count);
-            inorder_impl([&](const T& key) { result.emplace_back(key); });
-        }
-        return result;
-    }
-
-    std::vector<T> preorder() const override {
-        std::vector<T> result;
-        if (root) {
-            result.reserve(node_count);
-            preorder_impl([&](const T& key) { result.emplace_back(key); });
-        }
-        return result;
-    }
-
-    std::vector<T> postorder() const override {
-        std::vector<T> result;
-        if (root) {
-            result.reserve(node_count);
-            postorder_impl([&](const T& key) { result.emplace_back(key); });
-        }
-        return result;
-    }
-
-    std::vector<T> level_order() const override {
-        std::vector<T> result;
-        if (root) {
-            result.reserve(node_count);
-            level_order_impl([&](const T& key) { result.emplace_back(key); });
-        }
-        return result;
-    }
-
-    // --------- Visitor методы --------- //    
-
-    void visit_inorder(std::function<void(const T&)> visitor) const override {
-        if (visitor) inorder_impl(visitor);
-    }
-
-    void visit_preorder(std::function<void(const T&)> visitor) const override {
-        if (visitor) preorder_impl(visitor);
-    }
-
-    void visit_postorder(std::function<void(const T&)> visitor) const override {
-        if (visitor) postorder_impl(visitor);
-    }
-
-    void visit_level_order(std::function<void(const T&)> visitor) const override {
-        if (visitor) level_order_impl(visitor);
-    }
+    //--------- Итераторы -------//
+    //begin()/end() - в TreeBase (см. TreeIterator.h)
+    using iterator = TreeIterator<Node>;
+    using const_iterator = iterator;
 
     //--------- Метрики -------//
 
-    int height() const override {
-        if (!root) return -1;
-        std::queue<const Node*> q;
-        q.push(root.get());
-        int height = -1;
-
-        while (!q.empty()) {
-            int levelSize = q.size();
-            height++;
-
-            for (int i = 0; i < levelSize; i++) {
-                const Node* current = q.front();
-                q.pop();
-
-                if (current->left) q.push(current->left.get());
-                if (current->right) q.push(current->right.get());
-            }
-        }
-        return height;
+    // Дерево статическое - высота вычисляется один раз при построении
+    int height() const {
+        return tree_height;
     }
 
     //--------- Дополнительные методы для OBST ---------//
@@ -268,46 +195,13 @@ public:
         return expected_cost_;
     }
 
-    //--------- Печать -------//
-
-    void print(std::ostream& os = std::cout) const override {
-        if (!root) {
-            os << "[empty]\n";
-            return;
-        }
-
-        std::queue<const Node*> q;
-        q.push(root.get());
-        int level = 0;
-
-        while (!q.empty()) {
-            int level_size = q.size();
-            os << "Level " << level << ": ";
-
-            for (int i = 0; i < level_size; ++i) {
-                const Node* current = q.front();
-                q.pop();
-
-                os << current->key;
-
-                if (current->left || current->right) {
-                    os << "[";
-                    if (current->left) os << "L:" << current->left->key;
-                    if (current->left && current->right) os << ",";
-                    if (current->right) os << "R:" << current->right->key;
-                    os << "]";
-                }
-                os << "  ";
-
-                if (current->left) q.push(current->left.get());
-                if (current->right) q.push(current->right.get());
-            }
-            os << "\n";
-            level++;
-        }
+protected:
+    // --------- Хуки TreeBase --------- //
+    // После clear() высота снова неизвестна
+    void on_clear() {
+        tree_height = -1;
     }
 
-protected:
     //вспомогательные функции для построения дерева    
     
     // Функция для сортировки ключей с вероятностями
@@ -458,6 +352,7 @@ protected:
         // 4. Строим дерево
         root = build_tree_from_roots(keys, root_table, 1, n);
         node_count = n;
+        tree_height = subtree_height(root.get());
     }
 
     //вспомогательная рекурсивная функция построения поддерева
@@ -479,90 +374,6 @@ protected:
         return node;
     }
 
-	// --------- Шаблонные реализации обходов --------- //
-	template<typename Action>
-	void inorder_impl(Action&& action) const {
-		if (!root) return;
-
-		std::stack<const Node*> stack;
-		const Node* current = root.get();
-
-		while (current || !stack.empty()) {
-			while (current) {
-				stack.push(current);
-				current = current->left.get();
-			}
-
-			current = stack.top();
-			stack.pop();
-			action(current->key);  // Вызываем action
-
-			current = current->right.get();
-		}
-	}
-
-	template<typename Action>
-	void preorder_impl(Action&& action) const {
-		if (!root) return;
-
-		std::stack<const Node*> stack;
-		stack.push(root.get());
-
-		while (!stack.empty()) {
-			const Node* current = stack.top();
-			stack.pop();
-			action(current->key);
-
-			if (current->right) stack.push(current->right.get());
-			if (current->left) stack.push(current->left.get());
-		}
-	}
-
-	template<typename Action>
-	void postorder_impl(Action&& action) const {
-		if (!root) return;
-
-		// Два стека
-		std::stack<const Node*> stack1, stack2;
-		stack1.push(root.get());
-
-		while (!stack1.empty()) {
-			const Node* current = stack1.top();
-			stack1.pop();
-			stack2.push(current);
-
-			if (current->left) stack1.push(current->left.get());
-			if (current->right) stack1.push(current->right.get());
-		}
-
-		while (!stack2.empty()) {
-			action(stack2.top()->key);
-			stack2.pop();
-		}
-	}
-
-	template<typename Action>
-	void level_order_impl(Action&& action) const {
-		if (!root) return;
-
-		std::vector<const Node*> current_lvl;
-		current_lvl.push_back(root.get());
-
-		while (!current_lvl.empty()) {
-			std::vector<const Node*> next_lvl;
-			next_lvl.reserve(current_lvl.size() * 2);  // Оптимизация!
-
-			for (const Node* node : current_lvl) {
-				action(node->key);
-
-				if (node->left) next_lvl.push_back(node->left.get());
-				if (node->right) next_lvl.push_back(node->right.get());
-			}
-
-			current_lvl = std::move(next_lvl);
-		}
-	}
-
 	//-------------- Общие служебные функции ---------//
 	//служебная функция копирования дерева (итеративная)
 	static std::unique_ptr<Node> clone(const Node* source_root) {
@@ -605,5 +416,6 @@ protected:
 	std::unique_ptr<Node> root = nullptr;
 	size_t node_count = 0;
     double expected_cost_ = 0.0;
+    int tree_height = -1;
 };
 
@@ -2,15 +2,17 @@
 #include <iostream>
 #include <memory>
 #include <concepts>
-#include "ITree.h"
+#include "TreeBase.h"
 #include <stack>
 #include <queue>
 #include <numeric>
 #include <algorithm>
 #include <random>
+#include <utility>
 
 template <std::totally_ordered T>
-class OptimalTreap : public ITree<T> {
+class OptimalTreap : public TreeBase<OptimalTreap<T>, T> {
+	friend TreeBase<OptimalTreap, T>;  // root/node_count и хуки для общего кода
 
 public:
 	struct Node { //структура для узла 
@@ -22,9 +24,12 @@ public:
 		size_t access_count = 0;   // Счётчик обращений	
 		
 		//Конструкторы и присваивание
-		explicit Node(const T& k)
-			: key(k), left(nullptr), right(nullptr), base_priority(generate_base_priority()) {
-			priority = base_priority;			
+		explicit Node(T k)
+			: Node(std::move(k), generate_base_priority()) {}
+
+		Node(T k, double base)
+			: key(std::move(k)), left(nullptr), right(nullptr), base_priority(base) {
+			priority = base_priority;
 		}
 
 		//Копирование
@@ -77,16 +82,18 @@ public:
 	OptimalTreap(T key) : root(std::make_unique<Node>(Node(key))), node_count(1) {};
 
 	// Конструктор копирования
-	OptimalTreap(const OptimalTreap& other) : root(clone(other.root.get())), node_count(other.node_count) {};
+	OptimalTreap(const OptimalTreap& other)
+		: root(clone(other.root.get())), node_count(other.node_count), height_cache(other.height_cache) {};
 
 	// Конструктор перемещения
 	OptimalTreap(OptimalTreap&& other) noexcept
-		: root(std::move(other.root)), node_count(other.node_count) {
+		: root(std::move(other.root)), node_count(other.node_count), height_cache(other.height_cache) {
+		other.height_cache.invalidate();
 		other.root = nullptr;
 	}
 
-	virtual ~OptimalTreap() {
-		clear();
+	~OptimalTreap() {
+		this->clear();
 	};
 
 	// Оператор копирующего присваивания
@@ -94,38 +101,38 @@ public:
 		if (this != &other) {
 			root = clone(other.root.get());
 			node_count = other.node_count;
+			height_cache = other.height_cache;
 		}
 		return *this;
 	};
 
 	// Оператор перемещающего присваивания
 	OptimalTreap& operator=(OptimalTreap&& other) noexcept {
-		clear();
+		this->clear();
 		root = std::move(other.root);
 		node_count = other.node_count;
+		height_cache = other.height_cache;
 		other.root = nullptr;
 		other.node_count = 0;
+		other.height_cache.invalidate();
 		return *this;
 	};
 
 	//--------- Основные операции -------//
-	//вставка
-	void insert(const T& key) override {
-		// Сначала проверяем, есть ли уже
-		Node* existing = find_node(key); 
-
-		if (existing) {
-			// Уже есть — просто обновляем статистику
-			existing->record_access();			
-		}
-		else {
-			// Нет — вставляем
-			root = insert_impl(std::move(root), key);			
-		}		
-	};
+	//вставка за один спуск; повторная вставка считается обращением к ключу.
+	//Возвращает указатель на ключ в дереве и true, если ключ добавлен
+	std::pair<const T*, bool> insert(const T& key) {
+		return insert_impl(key);
+	}
+
+	//вставка перемещением: тяжёлый ключ не копируется
+	std::pair<const T*, bool> insert(T&& key) {
+		return insert_impl(std::move(key));
+	}
 
-	//поиск элемента
-	bool contains(const T& key) const override {
+	//поиск элемента; K - T или сравнимый с ним тип запроса
+	template<typename K = T> requires LookupKey<K, T>
+	bool contains(const K& key) const {
 		const Node* node = find_node(key);
 		return node != nullptr;
 	}
@@ -137,248 +144,124 @@ public:
 
 			node->record_access();
 
-			root = bubble_up_by_split_merge(std::move(root), key);
+			root = bubble_up_by_split_merge(std::move(root), node);
+			height_cache.invalidate();
 
 			return true;
 		}
 		return false;
 	}
 	//удаление элемента
-	void remove(const T& key) override {
-		root = remove_impl(std::move(root), key);		
-	}
-
-	//очистка дерева (итеративно)
-	void clear() override {
-		if (!root) return;
-
-		std::stack<std::unique_ptr<Node>> node_stack;
-		node_stack.push(std::move(root));  // Перемещаем владение в стек
-
-		while (!node_stack.empty()) {
-			auto node = std::move(node_stack.top());
-			node_stack.pop();
-
-			// Перемещаем детей в стек перед удалением node
-			if (node->left) {
-				node_stack.push(std::move(node->left));
-			}
-			if (node->right) {
-				node_stack.push(std::move(node->right));
-			}
-		}
-
-		node_count = 0;
-	}
-
-	//--------- Состояние -------//
-	//проверка на пустоту
-	bool empty() const override {
-		return !root;
-	};
-
-	// --------- Публичные методы обходов --------- //
-	std::vector<T> inorder() const override {
-		std::vector<T> result;
-		if (root) {
-			result.reserve(node_count);
-			inorder_impl([&](const T& key) { result.emplace_back(key); });
-		}
-		return result;
-	}
-
-	std::vector<T> preorder() const override {
-		std::vector<T> result;
-		if (root) {
-			result.reserve(node_count);
-			preorder_impl([&](const T& key) { result.emplace_back(key); });
-		}
-		return result;
-	}
-
-	std::vector<T> postorder() const override {
-		std::vector<T> result;
-		if (root) {
-			result.reserve(node_count);
-			postorder_impl([&](const T& key) { result.emplace_back(key); });
-		}
-		return result;
-	}
-
-	std::vector<T> level_order() const override {
-		std::vector<T> result;
-		if (root) {
-			result.reserve(node_count);
-			level_order_impl([&](const T& key) { result.emplace_back(key); });
+	void remove(const T& key) {
+		if (remove_impl(key)) {
+			--node_count;
+			height_cache.invalidate();
 		}
-		return result;
 	}
 
-	// --------- Visitor методы  --------- //	
-	void visit_inorder(std::function<void(const T&)> visitor) const override {
-		if (visitor) inorder_impl(visitor);
-	}
-	void visit_preorder(std::function<void(const T&)> visitor) const  override {
-		if (visitor) preorder_impl(visitor);
-	}
-	void visit_postorder(std::function<void(const T&)> visitor) const override {
-		if (visitor) postorder_impl(visitor);
-	}
-	void visit_level_order(std::function<void(const T&)> visitor) const override {
-		if (visitor) level_order_impl(visitor);
-	}
+	//--------- Итераторы -------//
+	//begin()/end() - в TreeBase (см. TreeIterator.h)
+	using iterator = TreeIterator<Node>;
+	using const_iterator = iterator;
 
 	//--------- Метрики -------//
-	//размер
-	size_t size() const override {
-		return node_count;
-	};
-
-	//высота	
-	int height() const override {
-
-		if (!root) return -1;
-		std::queue<const Node*> q;
-		q.push(root.get());
-		int height = -1;
-
-		while (!q.empty()) {
-			int levelSize = q.size();
-			height++;
-
-			for (int i = 0; i < levelSize; i++) {
-				const Node* current = q.front();
-				q.pop();
-
-				if (current->left) q.push(current->left.get());
-				if (current->right) q.push(current->right.get());
-			}
-		}
-		return height;
+	//высота (кэшируется до следующего изменения формы)
+	int height() const {
+		return height_cache.get([this] { return subtree_height(root.get()); });
 	}
 
-	//--------- Печать -------//
-	void print(std::ostream& os = std::cout) const override {
-
-		if (!root) {
-			os << "[empty]\n";
-			return;
-		}
-
-		std::queue<const Node*> q;
-		q.push(root.get());
-		int level = 0;
-
-		while (!q.empty()) {
-			int level_size = q.size();
-			os << "Level " << level << ": ";
-
-			for (int i = 0; i < level_size; ++i) {
-				const Node* current = q.front();
-				q.pop();
-
-				os << current->key;
-
-				// Показываем связи
-				if (current->left || current->right) {
-					os << "[";
-					if (current->left) os << "L:" << current->left->key;
-					if (current->left && current->right) os << ",";
-					if (current->right) os << "R:" << current->right->key;
-					os << "]";
-				}
-				os << "  ";
-
-				if (current->left) q.push(current->left.get());
-				if (current->right) q.push(current->right.get());
-			}
-			os << "\n";
-			level++;
-		}
-	}	
-
 protected:
 	//======== вспомогательные функции split и merge =====/
+	// Итеративный split сверху вниз: узлы подвешиваются к "крючкам" -
+	// правому краю левого результата и левому краю правого
 	static std::pair<std::unique_ptr<Node>, std::unique_ptr<Node>>
 		split(std::unique_ptr<Node> node, const T& key) {
 
-		if (!node) {
-			return { nullptr, nullptr };
-		}
-
-		if (node->key < key) { // Разделяем правое поддерево			
-
-			auto [left_of_right, right] = split(std::move(node->right), key);
-
-			// Присоединяем left_of_right как правое поддерево текущего узла
-			node->right = std::move(left_of_right);
-
-			// Текущий узел (с поддеревьями) + то, что получилось справа
-			return { std::move(node), std::move(right) };
+		std::unique_ptr<Node> left, right;
+		std::unique_ptr<Node>* left_hook = &left;    // куда встанет следующий узел < key
+		std::unique_ptr<Node>* right_hook = &right;  // куда встанет следующий узел >= key
 
+		while (node) {
+			if (node->key < key) { // node и его левое поддерево уходят влево, продолжаем справа
+				*left_hook = std::move(node);
+				left_hook = &(*left_hook)->right;
+				node = std::move(*left_hook);
+			}
+			else { // node и его правое поддерево уходят вправо, продолжаем слева
+				*right_hook = std::move(node);
+				right_hook = &(*right_hook)->left;
+				node = std::move(*right_hook);
+			}
 		}
-		else { // Разделяем левое поддерево
 
-			auto [left, right_of_left] = split(std::move(node->left), key);
-
-			// Присоединяем right_of_left как левое поддерево текущего узла
-			node->left = std::move(right_of_left);
-
-			// То, что получилось слева + текущий узел (с поддеревьями)
-			return { std::move(left), std::move(node) };
-		}
+		return { std::move(left), std::move(right) };
 	}
 
+	// Итеративный merge: спускаемся по правому краю left и левому краю right,
+	// выбирая корень с большим приоритетом (свойство кучи)
 	static std::unique_ptr<Node> merge(std::unique_ptr<Node> left,
 		std::unique_ptr<Node> right) {
-		// Базовые случаи
-		if (!left) return right;
-		if (!right) return left;
 
-		// Сравниваем приоритеты (свойство кучи)
-		if (left->priority > right->priority) { // left становится корнем, его приоритет больше
-
-			// Рекурсивно мержим правое поддерево left с right
-			left->right = merge(std::move(left->right), std::move(right));
-			return left;  // left - новый корень
+		std::unique_ptr<Node> result;
+		std::unique_ptr<Node>* hook = &result;
 
+		while (left && right) {
+			if (left->priority > right->priority) { // left - корень, сливаем его правое поддерево с right
+				*hook = std::move(left);
+				hook = &(*hook)->right;
+				left = std::move(*hook);
+			}
+			else { // right - корень, сливаем left с его левым поддеревом
+				*hook = std::move(right);
+				hook = &(*hook)->left;
+				right = std::move(*hook);
+			}
 		}
-		else { // right становится корнем, его приоритет больше или равен
 
-			// Рекурсивно мержим left с левым поддеревом right
-			right->left = merge(std::move(left), std::move(right->left));
-			return right;  // right - новый корень
-		}
+		*hook = left ? std::move(left) : std::move(right);
+		return result;
 	}
 
-	//функция локальной перестройки
+	//функция локальной перестройки: у target вырос приоритет, и он поднимается
+	//за один спуск - до первого узла пути с меньшим приоритетом, где
+	//остаток пути делится по ключу target прямо под ним
 	std::unique_ptr<Node> bubble_up_by_split_merge(
-		std::unique_ptr<Node> tree, const T& key) {
-
-		if (!tree) return nullptr;
+		std::unique_ptr<Node> tree, Node* target) {
 
-		// 1. Разделяем на <key и >=key
-		auto [left, middle_right] = split(std::move(tree), key);
-
-		if (!middle_right) {
-			// Ключа нет (но мы только что его нашли!)
-			return merge(std::move(left), std::move(middle_right));
+		const T& key = target->key;
+		std::unique_ptr<Node>* slot = &tree;
+		while (slot->get() != target && (*slot)->priority >= target->priority) {
+			slot = key < (*slot)->key ? &(*slot)->left : &(*slot)->right;
 		}
 
-		// 2. Разделяем middle_right на =key и >key
-		auto next_key = get_next_key(key);
-		auto [middle, right] = split(std::move(middle_right), next_key);
+		if (slot->get() == target) return tree;  // Свойство кучи не нарушено
+
+		std::unique_ptr<Node> left, right;
+		std::unique_ptr<Node>* left_hook = &left;
+		std::unique_ptr<Node>* right_hook = &right;
+		std::unique_ptr<Node> rest = std::move(*slot);
 
-		if (!middle) {
-			// Странно, но на всякий случай
-			return merge(std::move(left), merge(std::move(middle), std::move(right)));
+		while (rest.get() != target) {
+			if (rest->key < key) {
+				*left_hook = std::move(rest);
+				left_hook = &(*left_hook)->right;
+				rest = std::move(*left_hook);
+			}
+			else {
+				*right_hook = std::move(rest);
+				right_hook = &(*right_hook)->left;
+				rest = std::move(*right_hook);
+			}
 		}
 
-		// 3. middle содержит узел с key (приоритет уже обновлён в find_node)
-		// 4. Merge в правильном порядке: left + middle + right
-		//    Благодаря новому приоритету middle займёт правильное место
+		// Поддеревья target замыкают половины, сами половины становятся его детьми
+		*left_hook = std::move(rest->left);
+		*right_hook = std::move(rest->right);
+		rest->left = std::move(left);
+		rest->right = std::move(right);
+		*slot = std::move(rest);
 
-		return merge(merge(std::move(left), std::move(middle)), std::move(right));
+		return tree;
 	}
 
 	//-------------Вспомогательные функции для поиска -------//
@@ -386,10 +269,11 @@ protected:
 	Node* find_node(const T& key) {
 		Node* current = root.get();
 		while (current) {
-			if (key < current->key) {
+			const auto order = compare_keys(key, current->key);
+			if (order < 0) {
 				current = current->left.get();
 			}
-			else if (key > current->key) {
+			else if (order > 0) {
 				current = current->right.get();
 			}
 			else {				
@@ -399,13 +283,15 @@ protected:
 		return nullptr;  // Не нашли
 	}
 
-	Node* find_node(const T& key) const {
+	template<typename K>
+	Node* find_node(const K& key) const {
 		Node* current = root.get();
 		while (current) {
-			if (key < current->key) {
+			const auto order = compare_keys(key, current->key);
+			if (order < 0) {
 				current = current->left.get();
 			}
-			else if (key > current->key) {
+			else if (order > 0) {
 				current = current->right.get();
 			}
 			else {
@@ -415,88 +301,10 @@ protected:
 		return nullptr;  // Не нашли
 	}	
 
-	// --------- Шаблонные реализации обходов --------- //
-	template<typename Action>
-	void inorder_impl(Action&& action) const {
-		if (!root) return;
-
-		std::stack<const Node*> stack;
-		const Node* current = root.get();
-
-		while (current || !stack.empty()) {
-			while (current) {
-				stack.push(current);
-				current = current->left.get();
-			}
-
-			current = stack.top();
-			stack.pop();
-			action(current->key);  // Вызываем action
-
-			current = current->right.get();
-		}
-	}
-
-	template<typename Action>
-	void preorder_impl(Action&& action) const {
-		if (!root) return;
-
-		std::stack<const Node*> stack;
-		stack.push(root.get());
-
-		while (!stack.empty()) {
-			const Node* current = stack.top();
-			stack.pop();
-			action(current->key);
-
-			if (current->right) stack.push(current->right.get());
-			if (current->left) stack.push(current->left.get());
-		}
-	}
-
-	template<typename Action>
-	void postorder_impl(Action&& action) const {
-		if (!root) return;
-
-		// Два стека
-		std::stack<const Node*> stack1, stack2;
-		stack1.push(root.get());
-
-		while (!stack1.empty()) {
-			const Node* current = stack1.top();
-			stack1.pop();
-			stack2.push(current);
-
-			if (current->left) stack1.push(current->left.get());
-			if (current->right) stack1.push(current->right.get());
-		}
-
-		while (!stack2.empty()) {
-			action(stack2.top()->key);
-			stack2.pop();
-		}
-	}
-
-	template<typename Action>
-	void level_order_impl(Action&& action) const {
-		if (!root) return;
-
-		std::vector<const Node*> current_lvl;
-		current_lvl.push_back(root.get());
-
-		while (!current_lvl.empty()) {
-			std::vector<const Node*> next_lvl;
-			next_lvl.reserve(current_lvl.size() * 2);  // Оптимизация
-
-			for (const Node* node : current_lvl) {
-				action(node->key);
-
-				if (node->left) next_lvl.push_back(node->left.get());
-				if (node->right) next_lvl.push_back(node->right.get());
-			}
-
-			current_lvl = std::move(next_lvl);
-		}
+	// --------- Хуки TreeBase --------- //
+	//после clear() форма дерева изменилась
+	void on_clear() {
+		height_cache.invalidate();
 	}
 
 	//-------------- Общие служебные функции ---------//
@@ -514,112 +322,88 @@ protected:
 		return new_node;
 	}
 
-	std::unique_ptr<Node> insert_impl(std::unique_ptr<Node> node, const T& key) {
-		// Если дерево пустое - просто создаем новый узел
-		if (!node) {
-			++node_count;
-			return std::make_unique<Node>(key);
-		}
-
-		// Разделяем
-		auto [left, right] = split(std::move(node), key);
+	//служебная функция вставки за один спуск: до места нового узла по приоритету,
+	//затем оставшееся поддерево делится по key прямо под ним (в среднем O(1) узлов).
+	//Повторная вставка засчитывается как обращение и форму дерева не меняет.
+	//Ключ перемещается в узел только при успешной вставке
+	template<typename K>
+	std::pair<const T*, bool> insert_impl(K&& key) {
+		const double priority = Node::generate_base_priority();
 
-		// Создаем и объединяем
-		auto new_node = std::make_unique<Node>(key);
-		++node_count;
-
-		// Объединяем левое дерево с новым элементом и потом все вместе с правым деревом
-		return merge(merge(std::move(left), std::move(new_node)), std::move(right));
-	}
-
-	//--------------Удаление --------------------//
+		std::unique_ptr<Node>* slot = &root;
+		Node* current = root.get();
+		while (current) {
+			const auto order = compare_keys(key, current->key);
+			if (order < 0) {
+				current = current->left.get();
+			}
+			else if (order > 0) {
+				current = current->right.get();
+			}
+			else {
+				current->record_access();  // Дубликат
+				return { &current->key, false };
+			}
+			// место нового узла - первый узел пути с приоритетом не выше нового
+			if (slot->get()->priority > priority) {
+				slot = key < slot->get()->key ? &(*slot)->left : &(*slot)->right;
+			}
+		}
 
-	//Специализации функции получения следующего ключа
-	// Для integral
-	template<typename U = T>
-		requires std::integral<U>
-	static U get_next_key(const U& key) {
-		if (key == std::numeric_limits<U>::max()) return key;
-		return key + 1;
-	}
+		std::unique_ptr<Node> less, greater;  // будущие поддеревья нового узла
+		std::unique_ptr<Node>* left_hook = &less;
+		std::unique_ptr<Node>* right_hook = &greater;
+		std::unique_ptr<Node> rest = std::move(*slot);
 
-	// Для std::string
-	template<typename U = T>
-		requires std::same_as<U, std::string>
-	static U get_next_key(const U& key) {
-		if (key.empty()) return "\x00";
-
-		std::string result = key;
-		// Находим последний символ, который можно увеличить
-		for (auto it = result.rbegin(); it != result.rend(); ++it) {
-			if (*it != std::numeric_limits<unsigned char>::max()) {
-				++(*it);
-				// Обнуляем все символы справа
-				for (auto reset_it = result.rbegin(); reset_it != it; ++reset_it) {
-					*reset_it = '\x00';
-				}
-				return result;
+		while (rest) {
+			if (rest->key < key) {
+				*left_hook = std::move(rest);
+				left_hook = &(*left_hook)->right;
+				rest = std::move(*left_hook);
+			}
+			else {
+				*right_hook = std::move(rest);
+				right_hook = &(*right_hook)->left;
+				rest = std::move(*right_hook);
 			}
 		}
 
-		// Все символы на максимуме - добавляем нулевой байт
-		return key + '\x00';
-	}
-
-	// Для остальных типов - static_assert
-	template<typename U = T>
-	static U get_next_key(const U& key) {
-		static_assert(
-			std::is_integral_v<U> || std::is_same_v<U, std::string>,
-			"Treap requires get_next_key() for type T. "
-			"Either use int/long/std::string, or specialize get_next_key() for your type."
-			);
-		return key;
+		auto new_node = std::make_unique<Node>(std::forward<K>(key), priority);
+		new_node->left = std::move(less);
+		new_node->right = std::move(greater);
+		const T* inserted = &new_node->key;
+		*slot = std::move(new_node);
+		++node_count;
+		height_cache.invalidate();
+		return { inserted, true };
 	}
 
-	//собственно реализация удаления
-	std::unique_ptr<Node> remove_impl(std::unique_ptr<Node> node, const T& key) {
-		// 1. Разделяем на < key и >= key
-		auto [left, middle_right] = split(std::move(node), key);
-
-		if (!middle_right) {
-			// key не найден
-			return std::move(left);
-		}
-
-		// Если key не максимальное значение в диапазоне
-		auto next_key = get_next_key(key);
-		if (next_key != key) {
-			// Разделяем middle_right на < next_key и >= next_key
-			// Поскольку middle_right содержит >= key, то < next_key будет только == key
-			auto [middle, right] = split(std::move(middle_right), next_key);
+	//--------------Удаление --------------------//
 
-			if (middle) {
-				--node_count;
-				// middle должен содержать key
+	//служебная функция удаления: на место узла встаёт merge его поддеревьев
+	bool remove_impl(const T& key) {
+		std::unique_ptr<Node>* slot = &root;
+		while (*slot) {
+			Node* current = slot->get();
+			const auto order = compare_keys(key, current->key);
+			if (order < 0) {
+				slot = &current->left;
+			}
+			else if (order > 0) {
+				slot = &current->right;
+			}
+			else {
+				*slot = merge(std::move(current->left), std::move(current->right));
+				return true;
 			}
-
-			return merge(std::move(left), std::move(right));
-		}
-
-		// 3. key максимальный - особый случай		
-		// key должен быть корнем middle_right (как наименьший в >= key)
-		if (middle_right->key == key) {
-			// Нашли! Удаляем корень
-			--node_count;
-			auto right = std::move(middle_right->right);
-			// middle_right (содержащий key) уничтожится
-			return merge(std::move(left), std::move(right));
-		}
-		else {
-			// key нет, хотя он максимальный
-			return merge(std::move(left), std::move(middle_right));
 		}
-	}	
+		return false;
+	}
 
 protected:
 	std::unique_ptr<Node> root = nullptr;
 	size_t node_count = 0;
+	HeightCache height_cache;  // высота, пересчитываемая после изменения формы
 
 	// Данные для стратегий
 	size_t operations_since_rebuild = 0;	
@@ -0,0 +1,83 @@
+﻿#pragma once
+#include <vector>
+#include <thread>
+#include <future>
+#include <algorithm>
+#include <cstddef>
+
+// Минимальный размер куска, ради которого стоит заводить отдельный поток
+inline constexpr size_t PARALLEL_MIN_CHUNK = 1 << 14;
+
+// Число потоков по умолчанию
+inline unsigned default_build_threads() {
+	unsigned threads = std::thread::hardware_concurrency();
+	return threads ? threads : 1;
+}
+
+// Границы разбиения [0, n) не более чем на threads кусков не короче min_chunk
+inline std::vector<size_t> chunk_bounds(size_t n, unsigned threads,
+	size_t min_chunk = PARALLEL_MIN_CHUNK) {
+
+	size_t chunks = std::max<size_t>(1, std::min<size_t>(threads, n / min_chunk));
+	std::vector<size_t> bounds(chunks + 1);
+	for (size_t i = 0; i <= chunks; ++i) {
+		bounds[i] = n * i / chunks;
+	}
+	return bounds;
+}
+
+// task(i) для i из [0, count): нулевой кусок выполняется в текущем потоке,
+// остальные - на отдельных; возвращает управление после завершения всех
+template<typename Task>
+void run_parallel(size_t count, Task&& task) {
+	std::vector<std::future<void>> workers;
+	workers.reserve(count);
+	for (size_t i = 1; i < count; ++i) {
+		workers.push_back(std::async(std::launch::async, [&task, i] { task(i); }));
+	}
+
+	if (count > 0) task(0);
+	for (auto& worker : workers) {
+		worker.get();  // пробрасывает исключение потока
+	}
+}
+
+// Параллельная сортировка с удалением дубликатов: куски сортируются на своих
+// потоках, затем сливаются попарно, каждый раунд слияний тоже параллельно
+template<typename T>
+void parallel_sort_unique(std::vector<T>& keys, unsigned threads) {
+	auto bounds = chunk_bounds(keys.size(), threads);
+	size_t chunks = bounds.size() - 1;
+
+	run_parallel(chunks, [&](size_t i) {
+		std::sort(keys.begin() + bounds[i], keys.begin() + bounds[i + 1]);
+	});
+
+	for (size_t width = 1; width < chunks; width *= 2) {
+		size_t merges = (chunks - width + 2 * width - 1) / (2 * width);
+		run_parallel(merges, [&](size_t m) {
+			size_t first = 2 * width * m;
+			size_t last = std::min(first + 2 * width, chunks);
+			std::inplace_merge(keys.begin() + bounds[first],
+				keys.begin() + bounds[first + width],
+				keys.begin() + bounds[last]);
+		});
+	}
+
+	keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+}
+
+// Fork-join для рекурсивных алгоритмов: при parallel левая ветка уходит
+// на отдельный поток, правая выполняется в текущем
+template<typename LeftTask, typename RightTask>
+void fork_join(bool parallel, LeftTask&& left_task, RightTask&& right_task) {
+	if (!parallel) {
+		left_task();
+		right_task();
+		return;
+	}
+
+	auto left = std::async(std::launch::async, std::forward<LeftTask>(left_task));
+	right_task();
+	left.get();
+}
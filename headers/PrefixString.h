@@ -0,0 +1,101 @@
+﻿#pragma once
+#include <string>
+#include <string_view>
+#include <compare>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <ostream>
+
+/**
+ * Строковый ключ с кэшированным префиксом.
+ *
+ * Рядом со строкой хранятся её первые PREFIX_BYTES байт, упакованные в целое
+ * старшим байтом вперёд (недостающие - нули). Сравнение целых совпадает
+ * с лексикографическим сравнением байтов, поэтому спуск по дереву с такими
+ * ключами решает большинство сравнений по полю внутри узла и не читает буфер
+ * строки в куче - это лишний промах кэша на каждом уровне. К буферу
+ * обращаются только при равных префиксах.
+ *
+ * Подходит любому дереву библиотеки как тип ключа T: раскладка узла
+ * меняется вместе с ключом. Поиск можно вести по std::string_view
+ * без построения PrefixString.
+ */
+class PrefixString {
+public:
+	static constexpr size_t PREFIX_BYTES = sizeof(std::uint64_t);
+
+	//--------- Построение -------//
+	PrefixString() = default;
+
+	explicit PrefixString(std::string text)
+		: prefix(make_prefix(text)), text(std::move(text)) {}
+
+	explicit PrefixString(std::string_view text)
+		: PrefixString(std::string(text)) {}
+
+	explicit PrefixString(const char* text)
+		: PrefixString(std::string(text)) {}
+
+	//--------- Доступ -------//
+	const std::string& str() const noexcept {
+		return text;
+	}
+
+	operator std::string_view() const noexcept {
+		return text;
+	}
+
+	size_t size() const noexcept {
+		return text.size();
+	}
+
+	//--------- Сравнение -------//
+	friend bool operator==(const PrefixString& a, const PrefixString& b) noexcept {
+		return a.prefix == b.prefix && a.text == b.text;
+	}
+
+	friend std::strong_ordering operator<=>(const PrefixString& a, const PrefixString& b) noexcept {
+		if (a.prefix != b.prefix) return a.prefix <=> b.prefix;
+		return compare_tails(a.text, b.text);
+	}
+
+	//запрос-строка: его префикс собирается на месте, буфер запроса уже в кэше
+	friend bool operator==(const PrefixString& a, std::string_view b) noexcept {
+		return std::string_view(a.text) == b;
+	}
+
+	friend std::strong_ordering operator<=>(const PrefixString& a, std::string_view b) noexcept {
+		const std::uint64_t other = make_prefix(b);
+		if (a.prefix != other) return a.prefix <=> other;
+		return compare_tails(a.text, b);
+	}
+
+	friend std::ostream& operator<<(std::ostream& out, const PrefixString& s) {
+		return out << s.text;
+	}
+
+private:
+	//первые PREFIX_BYTES байт старшим байтом вперёд
+	static std::uint64_t make_prefix(std::string_view s) noexcept {
+		unsigned char bytes[PREFIX_BYTES] = {};
+		std::memcpy(bytes, s.data(), std::min(s.size(), PREFIX_BYTES));
+
+		std::uint64_t prefix = 0;
+		for (unsigned char byte : bytes) {
+			prefix = (prefix << 8) | byte;
+		}
+		return prefix;
+	}
+
+	//префиксы равны: первые min(длин, PREFIX_BYTES) байт совпадают,
+	//дальше сравниваются хвосты (и длины, если хвост одной строки пуст)
+	static std::strong_ordering compare_tails(std::string_view a, std::string_view b) noexcept {
+		const size_t skip = std::min({ a.size(), b.size(), PREFIX_BYTES });
+		return a.substr(skip) <=> b.substr(skip);
+	}
+
+	std::uint64_t prefix = 0;
+	std::string text;
+};
@@ -21,31 +21,36 @@ template<std::totally_ordered T,
     double Param = 0.1>  // Для FIXED - значение вероятности
 requires(Strategy != ProbabilityStrategy::FIXED || ValidProbability<Param>)
 
-class RandomizedBSTree : public BSTree<T> {
+class RandomizedBSTree : public BSTree<T, RandomizedBSTree<T, Strategy, Param>> {
+    friend TreeBase<RandomizedBSTree, T>;  // root/node_count и хуки для общего кода
 public:
     RandomizedBSTree() = default;
 
     // Наследуем конструкторы
-    using BSTree<T>::BSTree;
+    using BSTree<T, RandomizedBSTree>::BSTree;
 
-    void insert(const T& key) override {
-        // Пробуем вставить
-        bool inserted = try_insert(key);
+    std::pair<const T*, bool> insert(const T& key) {
+        return insert_key(key);
+    }
 
-        if (inserted && should_splay_to_root(this->node_count - 1)) {
-            // Перемещаем в корень
-            this->root = splay_to_root(std::move(this->root), key);
-        }        
-    }   
+    std::pair<const T*, bool> insert(T&& key) {
+        return insert_key(std::move(key));
+    }
 
 protected:
-    // Попытка вставки (возвращает true, если элемент был добавлен)
-    bool try_insert(const T& key) {
-        if (this->insert_impl(key)) {
-            ++this->node_count;
-            return true;
+    // Вставка; с вероятностью стратегии новый узел поднимается в корень
+    template<typename K>
+    std::pair<const T*, bool> insert_key(K&& key) {
+        auto result = this->insert_impl(std::forward<K>(key));
+        if (!result.second) return result;
+        ++this->node_count;
+
+        if (should_splay_to_root(this->node_count - 1)) {
+            // Перемещаем в корень (узел тот же - указатель на ключ остаётся верным)
+            this->root = splay_to_root(std::move(this->root), *result.first);
+            this->shape_changed();
         }
-        return false;
+        return result;
     }
     
     //определяем, надо ли поворачивать
@@ -80,25 +85,26 @@ protected:
     }
 
     // Перемещение узла с ключом key в корень
-    std::unique_ptr<typename BSTree<T>::Node> splay_to_root(
-        std::unique_ptr<typename BSTree<T>::Node> root, const T& key) {
+    std::unique_ptr<typename BSTree<T, RandomizedBSTree>::Node> splay_to_root(
+        std::unique_ptr<typename BSTree<T, RandomizedBSTree>::Node> root, const T& key) {
         
         if (!root || root->key == key) return root;
 
-        std::unique_ptr<typename BSTree<T>::Node> dummy_left, dummy_right;
-        typename BSTree<T>::Node* left_tree_max = nullptr;
-        typename BSTree<T>::Node* right_tree_min = nullptr;
+        std::unique_ptr<typename BSTree<T, RandomizedBSTree>::Node> dummy_left, dummy_right;
+        typename BSTree<T, RandomizedBSTree>::Node* left_tree_max = nullptr;
+        typename BSTree<T, RandomizedBSTree>::Node* right_tree_min = nullptr;
 
         // Временные узлы для сборки дерева
-        auto left_dummy = std::make_unique<typename BSTree<T>::Node>(T{});
-        auto right_dummy = std::make_unique<typename BSTree<T>::Node>(T{});
-        typename BSTree<T>::Node* left = left_dummy.get();
-        typename BSTree<T>::Node* right = right_dummy.get();
+        auto left_dummy = std::make_unique<typename BSTree<T, RandomizedBSTree>::Node>(T{});
+        auto right_dummy = std::make_unique<typename BSTree<T, RandomizedBSTree>::Node>(T{});
+        typename BSTree<T, RandomizedBSTree>::Node* left = left_dummy.get();
+        typename BSTree<T, RandomizedBSTree>::Node* right = right_dummy.get();
 
         auto current = std::move(root);
 
         while (current) {
-            if (key < current->key) {
+            const auto order = compare_keys(key, current->key);
+            if (order < 0) {
                 if (current->left && key < current->left->key) {
                     // Zig-Zig: правый поворот
                     current = rotate_right(std::move(current));
@@ -110,7 +116,7 @@ protected:
                 right = right->left.get();
                 current = std::move(right->left);
             }
-            else if (key > current->key) {
+            else if (order > 0) {
                 if (current->right && key > current->right->key) {
                     // Zag-Zag: левый поворот
                     current = rotate_left(std::move(current));
@@ -140,8 +146,8 @@ protected:
     }
 
     // Правый поворот
-    std::unique_ptr<typename BSTree<T>::Node>
-        rotate_right(std::unique_ptr<typename BSTree<T>::Node> x) {
+    std::unique_ptr<typename BSTree<T, RandomizedBSTree>::Node>
+        rotate_right(std::unique_ptr<typename BSTree<T, RandomizedBSTree>::Node> x) {
         
         if (!x || !x->left) return x;
         auto y = std::move(x->left);
@@ -151,8 +157,8 @@ protected:
     }
 
     // Левый поворот
-    std::unique_ptr<typename BSTree<T>::Node>
-        rotate_left(std::unique_ptr<typename BSTree<T>::Node> x) {        
+    std::unique_ptr<typename BSTree<T, RandomizedBSTree>::Node>
+        rotate_left(std::unique_ptr<typename BSTree<T, RandomizedBSTree>::Node> x) {        
         
         if (!x || !x->right) return x;
         auto y = std::move(x->right);
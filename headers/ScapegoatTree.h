@@ -0,0 +1,160 @@
+﻿#pragma once
+#include "BSTree.h"
+#include <memory>
+#include <concepts>
+#include <vector>
+#include <stack>
+#include <cmath>
+
+// Концепт для проверки параметра сбалансированности
+template<double A>
+concept ValidAlpha = (A > 0.5 && A < 1.0);
+
+// Scapegoat-дерево: узлы те же, что у BSTree, без служебных полей.
+// Если после вставки глубина превышает log_{1/Alpha} n, поддерево
+// "козла отпущения" перестраивается в идеально сбалансированное за линейное время.
+template<std::totally_ordered T, double Alpha = 0.7>
+requires ValidAlpha<Alpha>
+class ScapegoatTree : public BSTree<T, ScapegoatTree<T, Alpha>> {
+    friend TreeBase<ScapegoatTree, T>;  // root/node_count и хуки для общего кода
+    using Node = typename BSTree<T, ScapegoatTree>::Node;
+
+public:
+    ScapegoatTree() = default;
+
+    // Наследуем конструкторы
+    using BSTree<T, ScapegoatTree>::BSTree;
+
+    std::pair<const T*, bool> insert(const T& key) {
+        return insert_key(key);
+    }
+
+    std::pair<const T*, bool> insert(T&& key) {
+        return insert_key(std::move(key));
+    }
+
+    void remove(const T& key) {
+        // После build_from_sorted счётчик ещё не поднят до размера дерева
+        max_node_count = std::max(max_node_count, this->node_count);
+        BSTree<T, ScapegoatTree>::remove(key);
+
+        // Слишком много удалений с последней перестройки - перестраиваем всё
+        if (this->node_count < Alpha * max_node_count) {
+            rebuild(this->root, this->node_count);
+            max_node_count = this->node_count;
+            this->shape_changed();
+        }
+    }
+
+protected:
+    // Хук TreeBase: вызывается из clear(), в том числе из build_from_sorted
+    // и перемещающего присваивания
+    void on_clear() {
+        BSTree<T, ScapegoatTree>::on_clear();
+        max_node_count = 0;
+    }
+
+    // Вставка листа; если он оказался слишком глубоко - перестройка
+    // поддерева "козла отпущения" (узлы переиспользуются, указатель на ключ верен)
+    template<typename K>
+    std::pair<const T*, bool> insert_key(K&& key) {
+        // Путь от корня до места вставки (указатели на unique_ptr)
+        std::vector<std::unique_ptr<Node>*> path;
+        path.push_back(&this->root);
+
+        while (*path.back()) {
+            Node* current = path.back()->get();
+            const auto order = compare_keys(key, current->key);
+            if (order < 0) {
+                path.push_back(&current->left);
+            }
+            else if (order > 0) {
+                path.push_back(&current->right);
+            }
+            else {
+                return { &current->key, false };  // Дубликат
+            }
+        }
+
+        *path.back() = std::make_unique<Node>(std::forward<K>(key));
+        const T* inserted = &(*path.back())->key;
+        ++this->node_count;
+        max_node_count = std::max(max_node_count, this->node_count);
+
+        size_t depth = path.size() - 1;
+        this->height_cache.leaf_inserted(static_cast<int>(depth));
+        if (depth <= height_limit(this->node_count)) return { inserted, true };
+
+        // Ищем козла отпущения, поднимаясь от нового узла и считая размеры
+        size_t child_size = 1;
+        for (size_t i = path.size() - 1; i > 0; --i) {
+            Node* child = path[i]->get();
+            Node* parent = path[i - 1]->get();
+            const Node* sibling = parent->left.get() == child
+                ? parent->right.get() : parent->left.get();
+
+            size_t parent_size = child_size + 1 + subtree_size(sibling);
+            if (child_size > Alpha * parent_size) {
+                rebuild(*path[i - 1], parent_size);
+                this->shape_changed();
+                return { inserted, true };
+            }
+            child_size = parent_size;
+        }
+        return { inserted, true };
+    }
+
+    // Допустимая глубина: floor(log_{1/Alpha} n)
+    static size_t height_limit(size_t n) {
+        return static_cast<size_t>(std::log(static_cast<double>(n)) / std::log(1.0 / Alpha));
+    }
+
+    // Количество узлов в поддереве (итеративно)
+    static size_t subtree_size(const Node* node) {
+        if (!node) return 0;
+
+        size_t count = 0;
+        std::stack<const Node*> stack;
+        stack.push(node);
+        while (!stack.empty()) {
+            const Node* current = stack.top();
+            stack.pop();
+            ++count;
+            if (current->left) stack.push(current->left.get());
+            if (current->right) stack.push(current->right.get());
+        }
+        return count;
+    }
+
+    // Перестройка поддерева в идеально сбалансированное, O(size)
+    static void rebuild(std::unique_ptr<Node>& subtree, size_t size) {
+        std::vector<std::unique_ptr<Node>> nodes;
+        nodes.reserve(size);
+        flatten(std::move(subtree), nodes);
+        subtree = BSTree<T, ScapegoatTree>::build_balanced(nodes, 0, nodes.size());
+    }
+
+    // Отцепляем узлы поддерева в порядке inorder (итеративно)
+    static void flatten(std::unique_ptr<Node> current,
+        std::vector<std::unique_ptr<Node>>& nodes) {
+
+        std::stack<std::unique_ptr<Node>> stack;
+        while (current || !stack.empty()) {
+            while (current) {
+                auto left = std::move(current->left);
+                stack.push(std::move(current));
+                current = std::move(left);
+            }
+
+            current = std::move(stack.top());
+            stack.pop();
+
+            auto right = std::move(current->right);
+            nodes.push_back(std::move(current));
+            current = std::move(right);
+        }
+    }
+
+protected:
+    size_t max_node_count = 0;  // максимальный размер с последней полной перестройки
+};
@@ -0,0 +1,53 @@
+﻿#pragma once
+#include <concepts>
+#include <vector>
+#include <functional>
+#include <ostream>
+#include <ranges>
+#include <cstddef>
+#include <utility>
+
+// Статический интерфейс дерева поиска - то же, что ITree<T>, но без
+// виртуальных вызовов: шаблонный код (TreeTest и т.п.) работает с конкретным
+// типом дерева, и поиск в тесных циклах встраивается целиком.
+// Для работы через общий указатель есть адаптер TreeAdapter (ITree.h).
+template<typename Tree, typename T>
+concept SearchTree = std::totally_ordered<T> &&
+	std::ranges::bidirectional_range<const Tree> &&
+	requires(Tree& tree, const Tree& ctree, const T& key,
+		std::function<bool(const T&)> visitor, std::ostream& os) {
+
+		// Основные операции: вставка возвращает указатель на ключ в дереве
+		// и признак того, что ключ добавлен
+		{ tree.insert(key) } -> std::same_as<std::pair<const T*, bool>>;
+		{ tree.insert(T(key)) } -> std::same_as<std::pair<const T*, bool>>;
+		{ tree.emplace(key) } -> std::same_as<std::pair<const T*, bool>>;
+		tree.remove(key);
+		tree.clear();
+		{ ctree.contains(key) } -> std::convertible_to<bool>;
+
+		// Состояние и характеристики
+		{ ctree.empty() } -> std::convertible_to<bool>;
+		{ ctree.size() } -> std::convertible_to<std::size_t>;
+		{ ctree.height() } -> std::convertible_to<int>;
+
+		// Обходы
+		{ ctree.inorder() } -> std::same_as<std::vector<T>>;
+		{ ctree.preorder() } -> std::same_as<std::vector<T>>;
+		{ ctree.postorder() } -> std::same_as<std::vector<T>>;
+		{ ctree.level_order() } -> std::same_as<std::vector<T>>;
+		{ ctree.visit_inorder(visitor) } -> std::same_as<bool>;
+		{ ctree.visit_preorder(visitor) } -> std::same_as<bool>;
+		{ ctree.visit_postorder(visitor) } -> std::same_as<bool>;
+		{ ctree.visit_level_order(visitor) } -> std::same_as<bool>;
+
+		// Упорядоченная навигация
+		{ ctree.lower_bound(key) } -> std::same_as<const T*>;
+		{ ctree.upper_bound(key) } -> std::same_as<const T*>;
+		{ ctree.floor(key) } -> std::same_as<const T*>;
+		{ ctree.ceiling(key) } -> std::same_as<const T*>;
+		{ ctree.visit_range(key, key, visitor) } -> std::same_as<bool>;
+
+		// Визуализация
+		ctree.print(os);
+	};
@@ -0,0 +1,399 @@
+﻿#pragma once
+#include <iostream>
+#include <memory>
+#include <concepts>
+#include <stack>
+#include <stdexcept>
+#include <cstdint>
+#include <algorithm>
+#include "KeyCompare.h"
+#include "TreeShape.h"
+
+/**
+ * Кэш ограниченного размера на основе splay-дерева.
+ *
+ * Каждое обращение поднимает узел в корень, поэтому давно не использовавшиеся
+ * ключи оседают в глубине дерева. При переполнении вытесняется лист с самой
+ * старой отметкой последнего обращения среди всех листьев. Каждый узел хранит
+ * наименьшую отметку среди листьев своего поддерева (пересчитывается снизу
+ * вверх при splay и вставке), поэтому спуск к такому листу идёт по одному пути;
+ * затем лист поднимается splay-ем и удаляется - амортизированно O(log n),
+ * как обычный доступ к splay-дереву.
+ */
+template <std::totally_ordered K, typename V>
+class SplayCache {
+
+public:
+
+	struct Node { //структура для узла
+		K key;
+		V value;
+		uint64_t last_access;  // отметка последнего обращения
+		uint64_t oldest_leaf;  // наименьшая отметка среди листьев поддерева
+		std::unique_ptr<Node> left;
+		std::unique_ptr<Node> right;
+
+		//Конструкторы и присваивание
+		Node(const K& k, V v, uint64_t tick)
+			: key(k), value(std::move(v)), last_access(tick), oldest_leaf(tick), left(nullptr), right(nullptr) {}
+
+		//Копирование
+		Node(const Node&) = delete;
+		Node& operator=(const Node&) = delete;
+
+		//Перемещение
+		Node(Node&& other) noexcept = default;
+		Node& operator=(Node&& other) noexcept = default;
+
+		~Node() = default;
+	};
+
+	// Счётчики для сравнения с другими политиками кэширования
+	struct Stats {
+		size_t hits = 0;
+		size_t misses = 0;
+		size_t evictions = 0;
+	};
+
+public:
+	//--------- конструкторы и операторы присваивания -------//
+
+	explicit SplayCache(size_t capacity) : max_size(capacity) {
+		if (capacity == 0) {
+			throw std::invalid_argument("SplayCache capacity must be positive");
+		}
+	}
+
+	// Конструктор копирования
+	SplayCache(const SplayCache& other)
+		: root(clone(other.root.get())), node_count(other.node_count),
+		max_size(other.max_size), tick(other.tick), counters(other.counters) {}
+
+	// Конструктор перемещения
+	SplayCache(SplayCache&& other) noexcept
+		: root(std::move(other.root)), node_count(other.node_count),
+		max_size(other.max_size), tick(other.tick), counters(other.counters) {
+		other.node_count = 0;
+	}
+
+	virtual ~SplayCache() {
+		clear();
+	}
+
+	// Оператор копирующего присваивания
+	SplayCache& operator=(const SplayCache& other) {
+		if (this != &other) {
+			root = clone(other.root.get());
+			node_count = other.node_count;
+			max_size = other.max_size;
+			tick = other.tick;
+			counters = other.counters;
+		}
+		return *this;
+	}
+
+	// Оператор перемещающего присваивания
+	SplayCache& operator=(SplayCache&& other) noexcept {
+		if (this != &other) {
+			clear();
+			root = std::move(other.root);
+			node_count = other.node_count;
+			max_size = other.max_size;
+			tick = other.tick;
+			counters = other.counters;
+			other.node_count = 0;
+		}
+		return *this;
+	}
+
+	//--------- Основные операции -------//
+	//поиск значения; попадание поднимает узел в корень
+	V* get(const K& key) {
+		if (root) {
+			root = splay(std::move(root), key);
+			if (root->key == key) {
+				root->last_access = ++tick;
+				update(root.get());
+				++counters.hits;
+				return &root->value;
+			}
+		}
+		++counters.misses;
+		return nullptr;
+	}
+
+	//вставка или обновление значения; true, если ключ добавлен
+	bool put(const K& key, V value) {
+		if (root) {
+			root = splay(std::move(root), key);
+			if (root->key == key) {
+				root->value = std::move(value);
+				root->last_access = ++tick;
+				update(root.get());
+				return false;
+			}
+		}
+
+		// Освобождаем место до вставки, чтобы не вытеснить новый ключ
+		if (node_count >= max_size) {
+			evict();
+		}
+
+		auto new_node = std::make_unique<Node>(key, std::move(value), ++tick);
+
+		if (root) {
+			// Корень - ближайший к key элемент после splay
+			root = splay(std::move(root), key);
+			if (key < root->key) {
+				new_node->left = std::move(root->left);
+				update(root.get());
+				new_node->right = std::move(root);
+			}
+			else {
+				new_node->right = std::move(root->right);
+				update(root.get());
+				new_node->left = std::move(root);
+			}
+			update(new_node.get());
+		}
+		root = std::move(new_node);
+		++node_count;
+		return true;
+	}
+
+	//проверка наличия без изменения дерева и счётчиков
+	bool contains(const K& key) const {
+		const Node* current = root.get();
+		while (current) {
+			const auto order = compare_keys(key, current->key);
+			if (order < 0) {
+				current = current->left.get();
+			}
+			else if (order > 0) {
+				current = current->right.get();
+			}
+			else {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	//удаление ключа
+	bool erase(const K& key) {
+		if (!root) return false;
+
+		root = splay(std::move(root), key);
+		if (root->key != key) return false;
+
+		remove_root();
+		return true;
+	}
+
+	//очистка кэша (итеративно)
+	void clear() {
+		if (!root) return;
+
+		std::stack<std::unique_ptr<Node>> node_stack;
+		node_stack.push(std::move(root));  // Перемещаем владение в стек
+
+		while (!node_stack.empty()) {
+			auto node = std::move(node_stack.top());
+			node_stack.pop();
+
+			// Перемещаем детей в стек перед удалением node
+			if (node->left) {
+				node_stack.push(std::move(node->left));
+			}
+			if (node->right) {
+				node_stack.push(std::move(node->right));
+			}
+		}
+
+		node_count = 0;
+	}
+
+	//--------- Состояние -------//
+	bool empty() const {
+		return !root;
+	}
+
+	size_t size() const {
+		return node_count;
+	}
+
+	size_t capacity() const {
+		return max_size;
+	}
+
+	//--------- Статистика -------//
+	const Stats& stats() const {
+		return counters;
+	}
+
+	void reset_stats() {
+		counters = Stats{};
+	}
+
+protected:
+	// Итеративный top-down splay; вспомогательные деревья собираются
+	// прямо в unique_ptr, без фиктивных узлов. Узлы, подвешенные на крючки,
+	// меняют детей до конца сборки - их oldest_leaf пересчитывается после неё
+	static std::unique_ptr<Node> splay(std::unique_ptr<Node> current, const K& key) {
+		std::unique_ptr<Node> left_tree;   // ключи < key
+		std::unique_ptr<Node> right_tree;  // ключи > key
+		std::unique_ptr<Node>* left_hook = &left_tree;
+		std::unique_ptr<Node>* right_hook = &right_tree;
+		InlineStack<Node*> hooked;         // сверху вниз в своих деревьях
+
+		while (true) {
+			const auto order = compare_keys(key, current->key);
+			if (order < 0) {
+				if (!current->left) break;
+
+				if (key < current->left->key) {
+					// ZIG-ZIG: делаем правый поворот
+					auto child = std::move(current->left);
+					current->left = std::move(child->right);
+					child->right = std::move(current);
+					current = std::move(child);
+					update(current->right.get());  // его поддерево уже окончательное
+
+					if (!current->left) break;
+				}
+
+				// Подвешиваем current в правое дерево
+				*right_hook = std::move(current);
+				hooked.push(right_hook->get());
+				current = std::move((*right_hook)->left);
+				right_hook = &(*right_hook)->left;
+			}
+			else if (order > 0) {
+				if (!current->right) break;
+
+				if (key > current->right->key) {
+					// ZAG-ZAG: делаем левый поворот
+					auto child = std::move(current->right);
+					current->right = std::move(child->left);
+					child->left = std::move(current);
+					current = std::move(child);
+					update(current->left.get());
+
+					if (!current->right) break;
+				}
+
+				// Подвешиваем current в левое дерево
+				*left_hook = std::move(current);
+				hooked.push(left_hook->get());
+				current = std::move((*left_hook)->right);
+				left_hook = &(*left_hook)->right;
+			}
+			else {
+				break;
+			}
+		}
+
+		// Сборка
+		*left_hook = std::move(current->left);
+		*right_hook = std::move(current->right);
+		current->left = std::move(left_tree);
+		current->right = std::move(right_tree);
+
+		// Нижние узлы каждого вспомогательного дерева подвешены позже верхних
+		while (!hooked.empty()) {
+			update(hooked.pop());
+		}
+		update(current.get());
+
+		return current;
+	}
+
+	// Пересчёт oldest_leaf узла по детям
+	static void update(Node* node) {
+		if (node->left && node->right) {
+			node->oldest_leaf = std::min(node->left->oldest_leaf, node->right->oldest_leaf);
+		}
+		else if (node->left) {
+			node->oldest_leaf = node->left->oldest_leaf;
+		}
+		else if (node->right) {
+			node->oldest_leaf = node->right->oldest_leaf;
+		}
+		else {
+			node->oldest_leaf = node->last_access;
+		}
+	}
+
+	// Удаление корня (как в SplayTree::remove)
+	void remove_root() {
+		if (!root->left) {
+			root = std::move(root->right);
+		}
+		else if (!root->right) {
+			root = std::move(root->left);
+		}
+		else {
+			auto right_subtree = std::move(root->right);
+			const K key = root->key;
+			// Максимум левого поддерева поднимается в его корень
+			root = splay(std::move(root->left), key);
+			root->right = std::move(right_subtree);
+			update(root.get());
+		}
+		--node_count;
+	}
+
+	// Вытеснение самого давно использованного листа: спуск в ребёнка,
+	// в поддереве которого лежит наименьшая отметка (отметки уникальны)
+	void evict() {
+		if (!root) return;
+
+		const Node* victim = root.get();
+		while (victim->left || victim->right) {
+			victim = victim->left && victim->left->oldest_leaf == victim->oldest_leaf
+				? victim->left.get() : victim->right.get();
+		}
+
+		root = splay(std::move(root), victim->key);
+		remove_root();
+		++counters.evictions;
+	}
+
+	//служебная функция копирования дерева (итеративная)
+	static std::unique_ptr<Node> clone(const Node* source_root) {
+		if (!source_root) return nullptr;
+
+		auto copy = [](const Node* node) {
+			auto result = std::make_unique<Node>(node->key, node->value, node->last_access);
+			result->oldest_leaf = node->oldest_leaf;
+			return result;
+		};
+		auto new_root = copy(source_root);
+
+		std::stack<std::pair<const Node*, Node*>> stack;
+		stack.push({ source_root, new_root.get() });
+
+		while (!stack.empty()) {
+			auto [src_node, dst_node] = stack.top();
+			stack.pop();
+
+			if (src_node->left) {
+				dst_node->left = copy(src_node->left.get());
+				stack.push({ src_node->left.get(), dst_node->left.get() });
+			}
+			if (src_node->right) {
+				dst_node->right = copy(src_node->right.get());
+				stack.push({ src_node->right.get(), dst_node->right.get() });
+			}
+		}
+
+		return new_root;
+	}
+
+protected:
+	std::unique_ptr<Node> root = nullptr;
+	size_t node_count = 0;
+	size_t max_size;
+	uint64_t tick = 0;  // логическое время обращений
+	Stats counters;
+};
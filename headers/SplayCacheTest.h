@@ -0,0 +1,382 @@
+﻿#pragma once
+#include <iostream>
+#include <vector>
+#include <map>
+#include <string>
+#include <random>
+#include <chrono>
+#include <cassert>
+#include <algorithm>
+#include <cstdlib>
+#include <stack>
+#include <concepts>
+#include <stdexcept>
+#include <utility>
+#include <cstdint>
+#include "SplayCache.h"
+
+template <std::integral K>
+class SplayCacheTest {
+	using Cache = SplayCache<K, std::string>;
+
+	// Доступ к внутреннему дереву для проверки политики вытеснения
+	struct Probe : Cache {
+		using Cache::Cache;
+
+		// Ключ листа с наименьшей отметкой обращения (полный обход)
+		K oldest_leaf_key() const {
+			const typename Cache::Node* oldest = nullptr;
+			std::stack<const typename Cache::Node*> stack;
+			stack.push(this->root.get());
+			while (!stack.empty()) {
+				auto node = stack.top();
+				stack.pop();
+				if (!node->left && !node->right) {
+					if (!oldest || node->last_access < oldest->last_access) oldest = node;
+				}
+				if (node->left) stack.push(node->left.get());
+				if (node->right) stack.push(node->right.get());
+			}
+			return oldest->key;
+		}
+
+		// oldest_leaf каждого узла совпадает с минимумом по листьям поддерева
+		bool stamps_consistent() const {
+			std::stack<const typename Cache::Node*> stack;
+			if (this->root) stack.push(this->root.get());
+			while (!stack.empty()) {
+				auto node = stack.top();
+				stack.pop();
+				if (node->oldest_leaf != min_leaf_stamp(node)) return false;
+				if (node->left) stack.push(node->left.get());
+				if (node->right) stack.push(node->right.get());
+			}
+			return true;
+		}
+
+		void evict_now() {
+			this->evict();
+		}
+
+	private:
+		static uint64_t min_leaf_stamp(const typename Cache::Node* subtree) {
+			uint64_t result = UINT64_MAX;
+			std::stack<const typename Cache::Node*> stack;
+			stack.push(subtree);
+			while (!stack.empty()) {
+				auto node = stack.top();
+				stack.pop();
+				if (!node->left && !node->right) result = std::min(result, node->last_access);
+				if (node->left) stack.push(node->left.get());
+				if (node->right) stack.push(node->right.get());
+			}
+			return result;
+		}
+	};
+
+public:
+
+	static void comprehensive_test(size_t capacity) {
+		std::cout << "========================================\n";
+		std::cout << "SPLAY CACHE TEST (capacity = " << capacity << ")\n";
+		std::cout << "========================================\n\n";
+
+		// 1. Граничные случаи и ёмкость 1
+		test_edge_cases();
+
+		// 2. Заполнение, попадания и вытеснение при переполнении
+		test_capacity(capacity);
+
+		// 3. Политика вытеснения: самый давно использованный лист
+		test_eviction_policy(capacity);
+
+		// 4. Случайная трасса против эталона std::map
+		test_random_trace(capacity);
+
+		// 5. Копирование и перемещение
+		test_copy_move_semantics(capacity);
+
+		std::cout << "\n========================================\n";
+		std::cout << "ALL TESTS PASSED SUCCESSFULLY!\n";
+		std::cout << "========================================\n";
+	}
+
+private:
+
+	static std::string value_of(K key) {
+		return "value-" + std::to_string(key);
+	}
+
+	// ==================== 1. Граничные случаи ====================
+	static void test_edge_cases() {
+		std::cout << "1. EDGE CASES TEST\n";
+		std::cout << "------------------\n";
+
+		// 1.1 Нулевая ёмкость отклоняется
+		[[maybe_unused]] bool thrown = false;
+		try {
+			Cache cache(0);
+		}
+		catch (const std::invalid_argument&) {
+			thrown = true;
+		}
+		assert(thrown);
+		std::cout << "+ Zero capacity rejected\n";
+
+		// 1.2 Пустой кэш
+		Cache cache(1);
+		assert(cache.empty() && cache.size() == 0 && cache.capacity() == 1);
+		assert(cache.get(K(1)) == nullptr);
+		assert(!cache.erase(K(1)));
+		assert(cache.stats().misses == 1 && cache.stats().hits == 0);
+		std::cout << "+ Empty cache checks passed\n";
+
+		// 1.3 Ёмкость 1: каждый новый ключ вытесняет предыдущий
+		assert(cache.put(K(1), value_of(K(1))));
+		assert(cache.get(K(1)) && *cache.get(K(1)) == value_of(K(1)));
+		assert(cache.put(K(2), value_of(K(2))));
+		assert(cache.size() == 1 && cache.stats().evictions == 1);
+		assert(!cache.contains(K(1)) && cache.contains(K(2)));
+		assert(cache.get(K(1)) == nullptr);
+		std::cout << "+ Capacity 1 evicts previous key\n";
+
+		// 1.4 Обновление существующего ключа не вытесняет и не добавляет
+		assert(!cache.put(K(2), "updated"));
+		assert(cache.size() == 1 && cache.stats().evictions == 1);
+		assert(*cache.get(K(2)) == "updated");
+		std::cout << "+ Update in place passed\n";
+
+		// 1.5 erase и clear
+		assert(cache.erase(K(2)));
+		assert(cache.empty() && !cache.erase(K(2)));
+		cache.put(K(3), value_of(K(3)));
+		cache.clear();
+		assert(cache.empty() && cache.size() == 0);
+
+		// Счётчики: 3 попадания (1.3: два, 1.4: один), 2 промаха, 1 вытеснение
+		assert(cache.stats().hits == 3 && cache.stats().misses == 2 && cache.stats().evictions == 1);
+		cache.reset_stats();
+		assert(cache.stats().hits == 0 && cache.stats().misses == 0 && cache.stats().evictions == 0);
+		std::cout << "+ Erase, clear and counters passed\n";
+
+		std::cout << "++ All edge cases passed\n\n";
+	}
+
+	// ==================== 2. Ёмкость N ====================
+	static void test_capacity(size_t capacity) {
+		std::cout << "2. CAPACITY TEST\n";
+		std::cout << "----------------\n";
+
+		Cache cache(capacity);
+		for (size_t i = 0; i < capacity; i++) {
+			assert(cache.put(static_cast<K>(i), value_of(static_cast<K>(i))));
+		}
+		assert(cache.size() == capacity && cache.stats().evictions == 0);
+
+		for (size_t i = 0; i < capacity; i++) {
+			[[maybe_unused]] std::string* value = cache.get(static_cast<K>(i));
+			assert(value && *value == value_of(static_cast<K>(i)));
+		}
+		assert(cache.stats().hits == capacity && cache.stats().misses == 0);
+		std::cout << "+ " << capacity << " keys fit without eviction, all hits\n";
+
+		// Каждый следующий новый ключ вытесняет ровно один старый
+		for (size_t i = capacity; i < 2 * capacity; i++) {
+			cache.put(static_cast<K>(i), value_of(static_cast<K>(i)));
+			assert(cache.size() == capacity);
+			assert(cache.stats().evictions == i - capacity + 1);
+		}
+
+		size_t present = 0;
+		for (size_t i = 0; i < 2 * capacity; i++) {
+			if (cache.get(static_cast<K>(i))) ++present;
+		}
+		assert(present == capacity);
+		assert(cache.stats().hits == 2 * capacity && cache.stats().misses == capacity);
+		std::cout << "+ Overflow keeps size " << capacity << ", evictions: "
+			<< cache.stats().evictions << "\n";
+
+		// Удаление освобождает место: следующая вставка без вытеснения
+		K kept = static_cast<K>(2 * capacity - 1);
+		assert(cache.erase(kept) && cache.size() == capacity - 1);
+		[[maybe_unused]] size_t evictions = cache.stats().evictions;
+		cache.put(kept, value_of(kept));
+		assert(cache.stats().evictions == evictions);
+		std::cout << "+ Erase frees a slot\n";
+
+		std::cout << "++ Capacity test completed\n\n";
+	}
+
+	// ==================== 3. Политика вытеснения ====================
+	static void test_eviction_policy(size_t capacity) {
+		std::cout << "3. EVICTION POLICY TEST\n";
+		std::cout << "-----------------------\n";
+
+		Probe cache(capacity);
+		std::vector<K> keys(capacity);
+		for (size_t i = 0; i < capacity; i++) keys[i] = static_cast<K>(i);
+		std::mt19937 gen(std::random_device{}());
+		std::shuffle(keys.begin(), keys.end(), gen);
+		for (auto key : keys) cache.put(key, value_of(key));
+
+		// Перемешанные обращения меняют и форму дерева, и отметки
+		std::uniform_int_distribution<size_t> dist(0, capacity - 1);
+		for (size_t i = 0; i < 4 * capacity; i++) {
+			cache.get(keys[dist(gen)]);
+			assert(cache.stamps_consistent());
+		}
+
+		// Каждый раз вытесняется лист с самой старой отметкой
+		while (!cache.empty()) {
+			[[maybe_unused]] K victim = cache.oldest_leaf_key();
+			[[maybe_unused]] size_t size = cache.size();
+			cache.evict_now();
+			assert(!cache.contains(victim) && cache.size() == size - 1);
+			assert(cache.stamps_consistent());
+		}
+		assert(cache.stats().evictions == capacity);
+		std::cout << "+ " << capacity << " evictions, each took the least recently used leaf\n";
+
+		std::cout << "++ Eviction policy test completed\n\n";
+	}
+
+	// ==================== 4. Случайная трасса ====================
+	static void test_random_trace(size_t capacity) {
+		std::cout << "4. RANDOM TRACE TEST\n";
+		std::cout << "--------------------\n";
+
+		Probe cache(capacity);
+		std::map<K, std::string> shadow;
+		typename Cache::Stats expected;
+
+		std::mt19937 gen(std::random_device{}());
+		std::uniform_int_distribution<size_t> key_dist(0, 2 * capacity);
+		std::uniform_int_distribution<int> op_dist(0, 9);
+		size_t operations = 50 * capacity;
+
+		auto start = std::chrono::high_resolution_clock::now();
+		for (size_t i = 0; i < operations; i++) {
+			K key = static_cast<K>(key_dist(gen));
+			int op = op_dist(gen);
+
+			if (op < 6) {
+				std::string* value = cache.get(key);
+				[[maybe_unused]] auto it = shadow.find(key);
+				assert((value != nullptr) == (it != shadow.end()));
+				if (value) {
+					assert(*value == it->second);
+					++expected.hits;
+				}
+				else {
+					++expected.misses;
+				}
+			}
+			else if (op < 9) {
+				std::string value = value_of(key) + "#" + std::to_string(i);
+				[[maybe_unused]] bool added = cache.put(key, value);
+				assert(added == !shadow.count(key));
+				shadow[key] = value;
+
+				// Вытесненный ключ - единственный, которого больше нет в кэше
+				if (shadow.size() > capacity) {
+					for (auto it = shadow.begin(); it != shadow.end(); ++it) {
+						if (!cache.contains(it->first)) {
+							shadow.erase(it);
+							++expected.evictions;
+							break;
+						}
+					}
+				}
+			}
+			else {
+				[[maybe_unused]] bool erased = cache.erase(key);
+				assert(erased == (shadow.erase(key) > 0));
+			}
+
+			assert(cache.size() == shadow.size() && cache.size() <= capacity);
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+		auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+
+		assert(cache.stamps_consistent());
+		for ([[maybe_unused]] const auto& [key, value] : shadow) {
+			assert(cache.contains(key));
+		}
+		const auto& stats = cache.stats();
+		assert(stats.hits == expected.hits && stats.misses == expected.misses
+			&& stats.evictions == expected.evictions);
+
+		std::cout << "+ " << operations << " operations match std::map (with shadow checks): "
+			<< duration.count() << " ms\n";
+		std::cout << "  Hits: " << stats.hits << ", misses: " << stats.misses
+			<< ", evictions: " << stats.evictions << ", hit ratio: "
+			<< (stats.hits + stats.misses ? 100.0 * stats.hits / (stats.hits + stats.misses) : 0.0)
+			<< "%\n";
+
+		std::cout << "++ Random trace test completed\n\n";
+	}
+
+	// ==================== 5. Копирование и перемещение ====================
+	static void test_copy_move_semantics(size_t capacity) {
+		std::cout << "5. COPY/MOVE SEMANTICS TEST\n";
+		std::cout << "---------------------------\n";
+
+		Cache original(capacity);
+		for (size_t i = 0; i < capacity + capacity / 2; i++) {
+			original.put(static_cast<K>(i), value_of(static_cast<K>(i)));
+		}
+		original.get(static_cast<K>(capacity));
+
+		// 5.1 Конструктор копирования: то же содержимое и счётчики, но независимый кэш
+		Cache copy_constructed(original);
+		verify_equal(original, copy_constructed, capacity);
+		copy_constructed.put(static_cast<K>(10 * capacity), "copy only");
+		assert(!original.contains(static_cast<K>(10 * capacity)));
+		std::cout << "+ Copy constructor\n";
+
+		// 5.2 Оператор присваивания копированием
+		Cache copy_assigned(1);
+		copy_assigned = original;
+		verify_equal(original, copy_assigned, capacity);
+		std::cout << "+ Copy assignment\n";
+
+		// 5.3 Конструктор перемещения
+		Cache temp_for_move1 = original;
+		Cache move_constructed(std::move(temp_for_move1));
+		verify_equal(original, move_constructed, capacity);
+		assert(temp_for_move1.empty() && temp_for_move1.size() == 0);
+		std::cout << "+ Move constructor\n";
+
+		// 5.4 Оператор присваивания перемещением
+		Cache temp_for_move2 = original;
+		Cache move_assigned(1);
+		move_assigned = std::move(temp_for_move2);
+		verify_equal(original, move_assigned, capacity);
+		assert(temp_for_move2.empty() && temp_for_move2.size() == 0);
+		std::cout << "+ Move assignment\n";
+
+		// 5.5 Перемещённый кэш остаётся рабочим с прежней ёмкостью
+		for (size_t i = 0; i < 2 * capacity; i++) {
+			move_assigned.put(static_cast<K>(i), value_of(static_cast<K>(i)));
+		}
+		assert(move_assigned.size() == capacity);
+		std::cout << "+ Moved cache stays bounded\n";
+
+		std::cout << "++ Copy/move semantics test completed\n\n";
+	}
+
+	// Одинаковые ёмкость, размер, ключи, значения и счётчики
+	static void verify_equal(const Cache& expected, const Cache& actual, size_t capacity) {
+		assert(actual.capacity() == expected.capacity());
+		assert(actual.size() == expected.size());
+		assert(actual.stats().hits == expected.stats().hits);
+		assert(actual.stats().misses == expected.stats().misses);
+		assert(actual.stats().evictions == expected.stats().evictions);
+		for (size_t i = 0; i < 2 * capacity; i++) {
+			if (actual.contains(static_cast<K>(i)) != expected.contains(static_cast<K>(i))) {
+				std::cerr << "ERROR: caches differ at key " << i << "\n";
+				std::exit(1);
+			}
+		}
+	}
+};
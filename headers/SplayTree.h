@@ -10,56 +10,30 @@
 
 
 template<std::totally_ordered T>
-class SplayTree : public BSTree<T> {
+class SplayTree : public BSTree<T, SplayTree<T>> {
+    friend TreeBase<SplayTree, T>;  // root/node_count и хуки для общего кода
 public:
     // Наследуем конструкторы
-    using BSTree<T>::BSTree;
+    using BSTree<T, SplayTree>::BSTree;
 
-    // Вставка элемента
-    void insert(const T& key) override {
-        if (!this->root) {
-            // Пустое дерево
-            this->root = std::make_unique<typename BSTree<T>::Node>(key);
-            this->node_count = 1;
-            return;
-        }
-
-        // 1. Сначала делаем splay - поднимаем ближайший элемент в корень
-        this->root = splay(std::move(this->root), key);
-
-        // 2. Если ключ уже существует
-        if (this->root->key == key) {
-            return;  // Дубликат
-        }
-
-        // 3. Создаём новый узел
-        auto new_node = std::make_unique<typename BSTree<T>::Node>(key);
-
-        // 4. Вставляем новый узел в корень
-        if (key < this->root->key) {
-            // Ключ меньше корня
-            auto tmp = std::move(this->root->left);
-            new_node->right = std::move(this->root);            
-            new_node->left = std::move(tmp);
-            this->root = std::move(new_node);
-        }
-        else {
-            // Ключ больше корня
-            auto tmp = std::move(this->root->right);
-            new_node->left = std::move(this->root);
-            new_node->right = std::move(tmp);
-            this->root = std::move(new_node);
-        }
+    // Вставка элемента: новый или найденный ключ оказывается в корне.
+    // Возвращает указатель на ключ и true, если ключ добавлен
+    std::pair<const T*, bool> insert(const T& key) {
+        return insert_key(key);
+    }
 
-        ++this->node_count;        
-    }    
+    // Вставка перемещением: тяжёлый ключ не копируется
+    std::pair<const T*, bool> insert(T&& key) {
+        return insert_key(std::move(key));
+    }
 
     //удаление элемента
-    void remove(const T& key) override {
+    void remove(const T& key) {
         if (!this->root) return;
 
         // 1. Сначала делаем splay (даже если ключа нет)
         this->root = splay(std::move(this->root), key);
+        this->shape_changed();
 
         // 2. Если ключ не найден после splay - ничего не делаем
         if (this->root->key != key) {
@@ -96,24 +70,69 @@ public:
     //функция splay-поиска
     bool find_and_update(const T& key) {
         this->root = splay(std::move(this->root), key);
+        this->shape_changed();
         return this->root && this->root->key == key;
     }
 
-protected:    
+protected:
+    template<typename K>
+    std::pair<const T*, bool> insert_key(K&& key) {
+        if (!this->root) {
+            // Пустое дерево
+            this->root = std::make_unique<typename BSTree<T, SplayTree>::Node>(std::forward<K>(key));
+            this->node_count = 1;
+            this->height_cache.leaf_inserted(0);
+            return { &this->root->key, true };
+        }
+
+        // 1. Сначала делаем splay - поднимаем ближайший элемент в корень
+        this->root = splay(std::move(this->root), key);
+        this->shape_changed();
+
+        // 2. Если ключ уже существует
+        if (this->root->key == key) {
+            return { &this->root->key, false };  // Дубликат
+        }
+
+        // 3. Создаём новый узел (ключ перемещается только теперь - после сравнений)
+        const bool goes_left = key < this->root->key;
+        auto new_node = std::make_unique<typename BSTree<T, SplayTree>::Node>(std::forward<K>(key));
+
+        // 4. Вставляем новый узел в корень
+        if (goes_left) {
+            // Ключ меньше корня
+            auto tmp = std::move(this->root->left);
+            new_node->right = std::move(this->root);            
+            new_node->left = std::move(tmp);
+            this->root = std::move(new_node);
+        }
+        else {
+            // Ключ больше корня
+            auto tmp = std::move(this->root->right);
+            new_node->left = std::move(this->root);
+            new_node->right = std::move(tmp);
+            this->root = std::move(new_node);
+        }
+
+        ++this->node_count;
+        return { &this->root->key, true };
+    }
+
     // Итеративный splay
-    std::unique_ptr<typename BSTree<T>::Node> splay(
-        std::unique_ptr<typename BSTree<T>::Node> root, const T& key) {
+    std::unique_ptr<typename BSTree<T, SplayTree>::Node> splay(
+        std::unique_ptr<typename BSTree<T, SplayTree>::Node> root, const T& key) {
         if (!root) return nullptr;
 
-        auto left_dummy = std::make_unique<typename BSTree<T>::Node>(T{});
-        auto right_dummy = std::make_unique<typename BSTree<T>::Node>(T{});
-        typename BSTree<T>::Node* left_tail = left_dummy.get();
-        typename BSTree<T>::Node* right_tail = right_dummy.get();
+        auto left_dummy = std::make_unique<typename BSTree<T, SplayTree>::Node>(T{});
+        auto right_dummy = std::make_unique<typename BSTree<T, SplayTree>::Node>(T{});
+        typename BSTree<T, SplayTree>::Node* left_tail = left_dummy.get();
+        typename BSTree<T, SplayTree>::Node* right_tail = right_dummy.get();
 
-        std::unique_ptr<typename BSTree<T>::Node> current = std::move(root);
+        std::unique_ptr<typename BSTree<T, SplayTree>::Node> current = std::move(root);
 
         while (true) {
-            if (key < current->key) {
+            const auto order = compare_keys(key, current->key);
+            if (order < 0) {
                 if (!current->left) break;
 
                 if (key < current->left->key) {
@@ -132,7 +151,7 @@ protected:
                 current = std::move(right_tail->left);
 
             }
-            else if (key > current->key) {
+            else if (order > 0) {
                 if (!current->right) break;
 
                 if (key > current->right->key) {
@@ -3,28 +3,44 @@
 #include <iostream>
 #include <memory>
 #include <concepts>
-#include "ITree.h"
+#include "TreeBase.h"
+#include "BatchLookup.h"
+#include "TreeFinger.h"
 #include <stack>
 #include <queue>
 #include <numeric>
 #include <algorithm>
+#include <ranges>
+#include <vector>
+#include <span>
+#include <stdexcept>
 #include <random>
+#include "ParallelBuild.h"
+#include "Augmentation.h"
+#include <atomic>
 
-template <std::totally_ordered T>
-class Treap : public ITree<T> {
+// OrderStatistics = true хранит в узлах размеры поддеревьев (rank/select/count_range),
+// Aggregate - политика агрегата поддерева (SumAggregate, MaxAggregate ...; см. Augmentation.h)
+template <std::totally_ordered T, bool OrderStatistics = false, typename Aggregate = NoAggregate>
+	requires AggregatePolicy<Aggregate, T>
+class Treap : public TreeBase<Treap<T, OrderStatistics, Aggregate>, T> {
+	friend TreeBase<Treap, T>;  // root/node_count и хуки для общего кода
 
 public:
 
-	struct Node { //структура для узла 
+	struct Node : SubtreeSize<OrderStatistics>, SubtreeAggregate<T, Aggregate> { //структура для узла 
+		using aggregate_policy = Aggregate;
+
 		T key;
 		int priority;
 		std::unique_ptr<Node> left;
 		std::unique_ptr<Node> right;
 
-		// Генератор случайных чисел (статический, общий для всех узлов)
+		// Генератор случайных чисел (свой у каждого потока - узлы создаются
+		// и при параллельном построении)
 		static int generate_priority() {
-			static std::mt19937 generator(std::random_device{}());
-			static std::uniform_int_distribution<int> distribution(
+			static thread_local std::mt19937 generator(std::random_device{}());
+			static thread_local std::uniform_int_distribution<int> distribution(
 				std::numeric_limits<int>::min(),
 				std::numeric_limits<int>::max()
 			);
@@ -32,8 +48,11 @@ public:
 		}
 		
 		//Конструкторы и присваивание
-		explicit Node(const T& k)
-			: key(k), priority(generate_priority()), left(nullptr), right(nullptr) {}
+		explicit Node(T k)
+			: SubtreeAggregate<T, Aggregate>(k), key(std::move(k)), priority(generate_priority()), left(nullptr), right(nullptr) {}
+
+		Node(T k, int p)
+			: SubtreeAggregate<T, Aggregate>(k), key(std::move(k)), priority(p), left(nullptr), right(nullptr) {}
 
 		//Копирование
 		Node(const Node&) = delete;
@@ -65,16 +84,18 @@ public:
 	Treap(T key) : root(std::make_unique<Node>(Node(key))), node_count(1) {};
 
 	// Конструктор копирования
-	Treap(const Treap& other) : root(clone(other.root.get())), node_count(other.node_count) {};
+	Treap(const Treap& other)
+		: root(clone(other.root.get())), node_count(other.node_count), height_cache(other.height_cache) {};
 
 	// Конструктор перемещения
 	Treap(Treap&& other) noexcept
-		: root(std::move(other.root)), node_count(other.node_count) {
+		: root(std::move(other.root)), node_count(other.node_count), height_cache(other.height_cache) {
+		other.shape_changed();
 		other.root = nullptr;
 	}
 
-	virtual ~Treap() {
-		clear();
+	~Treap() {
+		this->clear();
 	};
 
 	// Оператор копирующего присваивания
@@ -82,41 +103,49 @@ public:
 		if (this != &other) {
 			root = clone(other.root.get());
 			node_count = other.node_count;
+			height_cache = other.height_cache;
+			finger.reset();
 		}
 		return *this;
 	};
 
 	// Оператор перемещающего присваивания
 	Treap& operator=(Treap&& other) noexcept {
-		clear();
+		this->clear();
 		root = std::move(other.root);
 		node_count = other.node_count;
+		height_cache = other.height_cache;
 		other.root = nullptr;
 		other.node_count = 0;
+		other.shape_changed();
 		return *this;
 	};
 
 	//--------- Основные операции -------//
-	//вставка
-	void insert(const T& key) override {		
-		if(!contains(key)) 
-			root = insert_impl(std::move(root), key);
-	};
+	//вставка (один спуск от пальца - последнего вставленного ключа: ключ правее
+	//максимума встаёт за амортизированное O(1) плюс ожидаемое O(1) поворотов).
+	//Возвращает указатель на ключ в дереве и true, если ключ добавлен
+	std::pair<const T*, bool> insert(const T& key) {
+		return insert_key(key);
+	}
 
-	//поиск элемента
-	bool contains(const T& key) const override {
-		// Ранний выход для пустого дерева
-		if (!root) return false;
+	//вставка перемещением: тяжёлый ключ не копируется
+	std::pair<const T*, bool> insert(T&& key) {
+		return insert_key(std::move(key));
+	}
 
+	//поиск элемента: одно трёхстороннее сравнение на уровень. K - сам T или
+	//сравнимый с ним тип запроса (std::string_view для строк), T не строится
+	template<typename K = T> requires LookupKey<K, T>
+	bool contains(const K& key) const {
 		const Node* current = root.get();
 
-		if (key == current->key) return true;
-
 		while (current) {
-			if (key < current->key) {
+			const auto order = compare_keys(key, current->key);
+			if (order < 0) {
 				current = current->left.get();
 			}
-			else if (key > current->key) {
+			else if (order > 0) {
 				current = current->right.get();
 			}
 			else {
@@ -126,298 +155,433 @@ public:
 		return false;
 	};
 
-	//удаление элемента
-	void remove(const T& key) override {
-		
-		root = remove_impl(std::move(root), key);
+	//поиск от пальца: подъём от ключа прошлой операции до общего поддерева
+	//и спуск оттуда. Для близких друг к другу ключей O(1) вместо O(log n)
+	bool contains_near(const T& key) {
+		return finger.seek(root, key) != nullptr;
 	}
 
-	//очистка дерева (итеративно)
-	void clear() override {
-		if (!root) return;
+	//пакетный поиск: out[i] = contains(keys[i]). Спуски идут группой по
+	//LOOKUP_GROUP с предвыборкой узлов, и промахи кэша перекрываются
+	void contains_many(std::span<const T> keys, std::span<bool> out) const {
+		contains_many_in(root.get(), keys, out);
+	}
 
-		std::stack<std::unique_ptr<Node>> node_stack;
-		node_stack.push(std::move(root));  // Перемещаем владение в стек
+	//удаление элемента (один спуск)
+	void remove(const T& key) {
+		if (remove_impl(key)) {
+			--node_count;
+			shape_changed();
+		}
+	}
 
-		while (!node_stack.empty()) {
-			auto node = std::move(node_stack.top());
-			node_stack.pop();
+	//--------- Массовое построение -------//
+	//построение из строго возрастающих ключей за O(n) (декартово дерево через стек правого края);
+	//прежнее содержимое заменяется
+	template<std::ranges::input_range Range>
+		requires std::convertible_to<std::ranges::range_reference_t<Range>, T>
+	void build_from_sorted(Range&& keys) {
+		auto nodes = make_sorted_nodes(keys);  // при ошибке дерево не меняется
+
+		this->clear();
+		node_count = nodes.size();
+		root = build_cartesian(nodes);
+		shape_changed();
+	}
 
-			// Перемещаем детей в стек перед удалением node
-			if (node->left) {
-				node_stack.push(std::move(node->left));
-			}
-			if (node->right) {
-				node_stack.push(std::move(node->right));
+	//параллельное построение из неупорядоченных ключей, дубликаты отбрасываются:
+	//куски отсортированных ключей строятся на своих потоках и сливаются merge
+	//(ключи кусков не пересекаются); прежнее содержимое заменяется
+	void build_from_unsorted(std::vector<T> keys, unsigned threads = default_build_threads()) {
+		parallel_sort_unique(keys, threads);
+
+		auto bounds = chunk_bounds(keys.size(), threads);
+		std::vector<std::unique_ptr<Node>> parts(bounds.size() - 1);
+		run_parallel(parts.size(), [&](size_t i) {
+			std::vector<std::unique_ptr<Node>> nodes;
+			nodes.reserve(bounds[i + 1] - bounds[i]);
+			for (size_t k = bounds[i]; k < bounds[i + 1]; ++k) {
+				nodes.push_back(std::make_unique<Node>(keys[k]));
 			}
+			parts[i] = build_cartesian(nodes);
+		});
+
+		std::unique_ptr<Node> new_root;
+		for (auto& part : parts) {
+			new_root = merge(std::move(new_root), std::move(part));
 		}
 
-		node_count = 0;
+		this->clear();
+		root = std::move(new_root);
+		node_count = keys.size();
+		shape_changed();
 	}
 
-	//--------- Состояние -------//
-	//проверка на пустоту
-	bool empty() const override {
-		return !root;
-	};
+	//--------- Операции над множествами -------//
+	// Алгоритмы на split/join за O(m log(n/m + 1)); other передаётся по значению
+	// (std::move, чтобы не копировать) и поглощается. Пока хватает потоков,
+	// рекурсивные ветви выполняются параллельно.
+
+	//объединение: дерево получает ключи other
+	void union_with(Treap other, unsigned threads = default_build_threads()) {
+		std::atomic<size_t> matches = 0;
+		size_t total = node_count + other.node_count;
+		root = union_impl(std::move(root), std::move(other.root), matches,
+			set_op_threads(total, threads));
+		node_count = total - matches;
+		other.node_count = 0;
+		shape_changed();
+	}
 
-	// --------- Публичные методы обходов --------- //
-	std::vector<T> inorder() const override {
-		std::vector<T> result;
-		if (root) {
-			result.reserve(node_count);
-			inorder_impl([&](const T& key) { result.emplace_back(key); });
-		}
-		return result;
+	//пересечение: остаются только ключи, которые есть и в other
+	void intersect_with(Treap other, unsigned threads = default_build_threads()) {
+		std::atomic<size_t> matches = 0;
+		root = intersect_impl(std::move(root), std::move(other.root), matches,
+			set_op_threads(node_count + other.node_count, threads));
+		node_count = matches;
+		other.node_count = 0;
+		shape_changed();
 	}
 
-	std::vector<T> preorder() const override {
-		std::vector<T> result;
-		if (root) {
-			result.reserve(node_count);
-			preorder_impl([&](const T& key) { result.emplace_back(key); });
-		}
-		return result;
+	//разность: удаляются ключи, которые есть в other
+	void difference_with(Treap other, unsigned threads = default_build_threads()) {
+		std::atomic<size_t> matches = 0;
+		root = difference_impl(std::move(root), std::move(other.root), matches,
+			set_op_threads(node_count + other.node_count, threads));
+		node_count -= matches;
+		other.node_count = 0;
+		shape_changed();
 	}
 
-	std::vector<T> postorder() const override {
-		std::vector<T> result;
-		if (root) {
-			result.reserve(node_count);
-			postorder_impl([&](const T& key) { result.emplace_back(key); });
+	//--------- Разделение и соединение -------//
+	//разделение на ключи < key и >= key; дерево остаётся пустым.
+	//Сама операция O(log n), плюс подсчёт размера меньшей половины
+	std::pair<Treap, Treap> split(const T& key) {
+		auto [left, right] = split(std::move(root), key);
+
+		std::pair<Treap, Treap> result;
+		if constexpr (OrderStatistics) {
+			result.first.node_count = size_of(left.get());
+		}
+		else {
+			auto [smaller, left_is_smaller] = smaller_subtree_size(left.get(), right.get());
+			result.first.node_count = left_is_smaller ? smaller : node_count - smaller;
 		}
+		result.second.node_count = node_count - result.first.node_count;
+		result.first.root = std::move(left);
+		result.second.root = std::move(right);
+
+		node_count = 0;
+		shape_changed();
 		return result;
 	}
 
-	std::vector<T> level_order() const override {
-		std::vector<T> result;
-		if (root) {
-			result.reserve(node_count);
-			level_order_impl([&](const T& key) { result.emplace_back(key); });
+	//соединение деревьев, где все ключи left меньше ключей right, O(log n)
+	static Treap join(Treap left, Treap right) {
+		if (!left.root) return right;
+		if (!right.root) return left;
+		if (!(max_node(left.root.get())->key < min_node(right.root.get())->key)) {
+			throw std::invalid_argument("join requires all keys of left to be less than keys of right");
 		}
-		return result;
-	}
 
-	// --------- Visitor методы  --------- //	
-	void visit_inorder(std::function<void(const T&)> visitor) const override {
-		if (visitor) inorder_impl(visitor);
-	}
-	void visit_preorder(std::function<void(const T&)> visitor) const  override {
-		if (visitor) preorder_impl(visitor);
-	}
-	void visit_postorder(std::function<void(const T&)> visitor) const override {
-		if (visitor) postorder_impl(visitor);
-	}
-	void visit_level_order(std::function<void(const T&)> visitor) const override {
-		if (visitor) level_order_impl(visitor);
+		Treap result;
+		result.node_count = left.node_count + right.node_count;
+		result.root = merge(std::move(left.root), std::move(right.root));
+		left.node_count = right.node_count = 0;
+		return result;
 	}
 
-	//--------- Метрики -------//
-	//размер
-	size_t size() const override {
-		return node_count;
-	};
-
-	//высота	
-	int height() const override {
+	//удаление всех ключей из [lo, hi); O(log n) на разрез и склейку
+	//плюс освобождение удалённых узлов. Возвращает число удалённых ключей
+	size_t erase_range(const T& lo, const T& hi) {
+		if (!root || !(lo < hi)) return 0;
 
-		if (!root) return -1;
-		std::queue<const Node*> q;
-		q.push(root.get());
-		int height = -1;
+		auto [left, rest] = split(std::move(root), lo);
+		auto [middle, right] = split(std::move(rest), hi);
+		root = merge(std::move(left), std::move(right));
 
-		while (!q.empty()) {
-			int levelSize = q.size();
-			height++;
+		size_t erased = destroy_subtree(std::move(middle));
+		node_count -= erased;
+		shape_changed();
+		return erased;
+	}
 
-			for (int i = 0; i < levelSize; i++) {
-				const Node* current = q.front();
-				q.pop();
+	//--------- Порядковые статистики -------//
+	//доступны при OrderStatistics = true, O(log n)
 
-				if (current->left) q.push(current->left.get());
-				if (current->right) q.push(current->right.get());
-			}
-		}
-		return height;
+	//число ключей, меньших key
+	size_t rank(const T& key) const requires OrderStatistics {
+		return rank_in(root.get(), key);
 	}
 
-	//--------- Печать -------//
-	void print(std::ostream& os = std::cout) const override {
-
-		if (!root) {
-			os << "[empty]\n";
-			return;
+	//k-й по возрастанию ключ (с нуля)
+	const T& select(size_t k) const requires OrderStatistics {
+		const Node* node = select_in(root.get(), k);
+		if (!node) {
+			throw std::out_of_range("select index out of range");
 		}
+		return node->key;
+	}
 
-		std::queue<const Node*> q;
-		q.push(root.get());
-		int level = 0;
+	//число ключей в [lo, hi)
+	size_t count_range(const T& lo, const T& hi) const requires OrderStatistics {
+		return lo < hi ? rank(hi) - rank(lo) : 0;
+	}
 
-		while (!q.empty()) {
-			int level_size = q.size();
-			os << "Level " << level << ": ";
+	//--------- Агрегаты поддеревьев -------//
+	//доступны, если задана политика Aggregate, O(log n)
 
-			for (int i = 0; i < level_size; ++i) {
-				const Node* current = q.front();
-				q.pop();
+	//агрегат всех ключей
+	auto total_aggregate() const requires (!std::same_as<Aggregate, NoAggregate>) {
+		return aggregate_of<Aggregate>(root.get());
+	}
 
-				os << current->key;
+	//агрегат ключей из [lo, hi)
+	auto aggregate(const T& lo, const T& hi) const requires (!std::same_as<Aggregate, NoAggregate>) {
+		return range_aggregate<Aggregate>(root.get(), lo, hi);
+	}
 
-				// Показываем связи
-				if (current->left || current->right) {
-					os << "[";
-					if (current->left) os << "L:" << current->left->key;
-					if (current->left && current->right) os << ",";
-					if (current->right) os << "R:" << current->right->key;
-					os << "]";
-				}
-				os << "  ";
+	//--------- Итераторы -------//
+	//begin()/end() - в TreeBase (см. TreeIterator.h)
+	using iterator = TreeIterator<Node>;
+	using const_iterator = iterator;
 
-				if (current->left) q.push(current->left.get());
-				if (current->right) q.push(current->right.get());
-			}
-			os << "\n";
-			level++;
-		}
+	//--------- Метрики -------//
+	//высота (кэшируется до следующего изменения формы)
+	int height() const {
+		return height_cache.get([this] { return subtree_height(root.get()); });
 	}
 
 
 protected:
+	// В узлах есть поля, пересчитываемые по детям
+	static constexpr bool Augmented = OrderStatistics || !std::same_as<Aggregate, NoAggregate>;
+
 	//======== вспомогательные функции split и merge =====/
+	// Итеративный split сверху вниз: узлы подвешиваются к "крючкам" -
+	// правому краю левого результата и левому краю правого
 	static std::pair<std::unique_ptr<Node>, std::unique_ptr<Node>>
 		split(std::unique_ptr<Node> node, const T& key) {
-		
-		if (!node) {
-			return { nullptr, nullptr };
+
+		std::unique_ptr<Node> left, right;
+		std::unique_ptr<Node>* left_hook = &left;    // куда встанет следующий узел < key
+		std::unique_ptr<Node>* right_hook = &right;  // куда встанет следующий узел >= key
+		AugmentFixup<Node, Augmented> touched;    // узлы на крючках теряют часть поддерева
+
+		while (node) {
+			touched.touch(node.get());
+			if (node->key < key) { // node и его левое поддерево уходят влево, продолжаем справа
+				*left_hook = std::move(node);
+				left_hook = &(*left_hook)->right;
+				node = std::move(*left_hook);
+			}
+			else { // node и его правое поддерево уходят вправо, продолжаем слева
+				*right_hook = std::move(node);
+				right_hook = &(*right_hook)->left;
+				node = std::move(*right_hook);
+			}
 		}
+		touched.apply();
 
-		if (node->key < key) { // Разделяем правое поддерево			
-			
-			auto [left_of_right, right] = split(std::move(node->right), key);
+		return { std::move(left), std::move(right) };
+	}
 
-			// Присоединяем left_of_right как правое поддерево текущего узла
-			node->right = std::move(left_of_right);
+	// Итеративный merge: спускаемся по правому краю left и левому краю right,
+	// выбирая корень с большим приоритетом (свойство кучи)
+	static std::unique_ptr<Node> merge(std::unique_ptr<Node> left,
+		std::unique_ptr<Node> right) {
 
-			// Текущий узел (с поддеревьями) + то, что получилось справа
-			return { std::move(node), std::move(right) };
+		std::unique_ptr<Node> result;
+		std::unique_ptr<Node>* hook = &result;
+		AugmentFixup<Node, Augmented> touched;
 
+		while (left && right) {
+			touched.touch(left->priority > right->priority ? left.get() : right.get());
+			if (left->priority > right->priority) { // left - корень, сливаем его правое поддерево с right
+				*hook = std::move(left);
+				hook = &(*hook)->right;
+				left = std::move(*hook);
+			}
+			else { // right - корень, сливаем left с его левым поддеревом
+				*hook = std::move(right);
+				hook = &(*hook)->left;
+				right = std::move(*hook);
+			}
 		}
-		else { // Разделяем левое поддерево
-			
-			auto [left, right_of_left] = split(std::move(node->left), key);
 
-			// Присоединяем right_of_left как левое поддерево текущего узла
-			node->left = std::move(right_of_left);
-
-			// То, что получилось слева + текущий узел (с поддеревьями)
-			return { std::move(left), std::move(node) };
-		}
+		*hook = left ? std::move(left) : std::move(right);
+		touched.apply();
+		return result;
 	}
 
-	static std::unique_ptr<Node> merge(std::unique_ptr<Node> left,
-		std::unique_ptr<Node> right) {
-		// Базовые случаи
-		if (!left) return right;
-		if (!right) return left;
+	static const Node* min_node(const Node* node) {
+		while (node->left) node = node->left.get();
+		return node;
+	}
 
-		// Сравниваем приоритеты (свойство кучи)
-		if (left->priority > right->priority) { // left становится корнем, его приоритет больше
-			
-			// Рекурсивно мержим правое поддерево left с right
-			left->right = merge(std::move(left->right), std::move(right));
-			return left;  // left - новый корень
+	static const Node* max_node(const Node* node) {
+		while (node->right) node = node->right.get();
+		return node;
+	}
 
+	// Трёхсторонний split: ключи < key и > key; узел с key (если есть) возвращается
+	// без детей - его поддеревья целиком уходят на крючки
+	static std::unique_ptr<Node> split_out(std::unique_ptr<Node> node, const T& key,
+		std::unique_ptr<Node>& left, std::unique_ptr<Node>& right) {
+
+		std::unique_ptr<Node>* left_hook = &left;
+		std::unique_ptr<Node>* right_hook = &right;
+		AugmentFixup<Node, Augmented> touched;
+
+		while (node) {
+			const auto order = compare_keys(key, node->key);
+			if (order != 0) touched.touch(node.get());
+			if (order > 0) {
+				*left_hook = std::move(node);
+				left_hook = &(*left_hook)->right;
+				node = std::move(*left_hook);
+			}
+			else if (order < 0) {
+				*right_hook = std::move(node);
+				right_hook = &(*right_hook)->left;
+				node = std::move(*right_hook);
+			}
+			else {
+				*left_hook = std::move(node->left);
+				*right_hook = std::move(node->right);
+				touched.apply();
+				return node;
+			}
 		}
-		else { // right становится корнем, его приоритет больше или равен
-			
-			// Рекурсивно мержим left с левым поддеревом right
-			right->left = merge(std::move(left), std::move(right->left));
-			return right;  // right - новый корень
-		}
-	}	
 
-	// --------- Шаблонные реализации обходов --------- //
-	template<typename Action>
-	void inorder_impl(Action&& action) const {
-		if (!root) return;
+		touched.apply();
+		return nullptr;
+	}
 
-		std::stack<const Node*> stack;
-		const Node* current = root.get();
+	// --------- Операции над множествами --------- //
+	// Число потоков для операции: мелкие деревья обрабатываем в одном
+	static unsigned set_op_threads(size_t total_size, unsigned threads) {
+		return total_size >= 2 * PARALLEL_MIN_CHUNK ? threads : 1;
+	}
 
-		while (current || !stack.empty()) {
-			while (current) {
-				stack.push(current);
-				current = current->left.get();
-			}
+	// Корень с большим приоритетом делит другое дерево по своему ключу;
+	// половины обрабатываются рекурсивно (левая - на отдельном потоке, пока
+	// есть бюджет) и подвешиваются к нему без нарушения свойства кучи
+	static std::unique_ptr<Node> union_impl(std::unique_ptr<Node> a, std::unique_ptr<Node> b,
+		std::atomic<size_t>& matches, unsigned threads) {
 
-			current = stack.top();
-			stack.pop();
-			action(current->key);  // Вызываем action
+		if (!a) return b;
+		if (!b) return a;
+		if (a->priority < b->priority) std::swap(a, b);
 
-			current = current->right.get();
-		}
+		std::unique_ptr<Node> b_left, b_right;
+		if (split_out(std::move(b), a->key, b_left, b_right)) ++matches;
+
+		unsigned left_threads = threads / 2;
+		fork_join(threads > 1,
+			[&] { a->left = union_impl(std::move(a->left), std::move(b_left), matches, left_threads); },
+			[&] { a->right = union_impl(std::move(a->right), std::move(b_right), matches, threads - left_threads); });
+
+		update_augmentation(a.get());
+		return a;
 	}
 
-	template<typename Action>
-	void preorder_impl(Action&& action) const {
-		if (!root) return;
+	static std::unique_ptr<Node> intersect_impl(std::unique_ptr<Node> a, std::unique_ptr<Node> b,
+		std::atomic<size_t>& matches, unsigned threads) {
 
-		std::stack<const Node*> stack;
-		stack.push(root.get());
+		if (!a || !b) return nullptr;
+		if (a->priority < b->priority) std::swap(a, b);
 
-		while (!stack.empty()) {
-			const Node* current = stack.top();
-			stack.pop();
-			action(current->key);
+		std::unique_ptr<Node> b_left, b_right;
+		bool matched = split_out(std::move(b), a->key, b_left, b_right) != nullptr;
 
-			if (current->right) stack.push(current->right.get());
-			if (current->left) stack.push(current->left.get());
+		unsigned left_threads = threads / 2;
+		fork_join(threads > 1,
+			[&] { a->left = intersect_impl(std::move(a->left), std::move(b_left), matches, left_threads); },
+			[&] { a->right = intersect_impl(std::move(a->right), std::move(b_right), matches, threads - left_threads); });
+
+		if (matched) {
+			++matches;
+			update_augmentation(a.get());
+			return a;
 		}
+		return merge(std::move(a->left), std::move(a->right));
 	}
 
-	template<typename Action>
-	void postorder_impl(Action&& action) const {
-		if (!root) return;
+	// Разность несимметрична: корнем всегда остаётся узел a
+	static std::unique_ptr<Node> difference_impl(std::unique_ptr<Node> a, std::unique_ptr<Node> b,
+		std::atomic<size_t>& matches, unsigned threads) {
 
-		// Два стека
-		std::stack<const Node*> stack1, stack2;
-		stack1.push(root.get());
+		if (!a) return nullptr;
+		if (!b) return a;
 
-		while (!stack1.empty()) {
-			const Node* current = stack1.top();
-			stack1.pop();
-			stack2.push(current);
+		std::unique_ptr<Node> b_left, b_right;
+		bool matched = split_out(std::move(b), a->key, b_left, b_right) != nullptr;
 
-			if (current->left) stack1.push(current->left.get());
-			if (current->right) stack1.push(current->right.get());
-		}
+		unsigned left_threads = threads / 2;
+		fork_join(threads > 1,
+			[&] { a->left = difference_impl(std::move(a->left), std::move(b_left), matches, left_threads); },
+			[&] { a->right = difference_impl(std::move(a->right), std::move(b_right), matches, threads - left_threads); });
 
-		while (!stack2.empty()) {
-			action(stack2.top()->key);
-			stack2.pop();
+		if (matched) {
+			++matches;
+			return merge(std::move(a->left), std::move(a->right));
 		}
+		update_augmentation(a.get());
+		return a;
 	}
 
-	template<typename Action>
-	void level_order_impl(Action&& action) const {
-		if (!root) return;
+	// --------- Хуки TreeBase --------- //
+	//после clear() форма дерева изменилась
+	void on_clear() {
+		shape_changed();
+	}
 
-		std::vector<const Node*> current_lvl;
-		current_lvl.push_back(root.get());
+	//форма изменилась в обход пальца: высоту пересчитать, путь забыть
+	void shape_changed() {
+		height_cache.invalidate();
+		finger.reset();
+	}
 
-		while (!current_lvl.empty()) {
-			std::vector<const Node*> next_lvl;
-			next_lvl.reserve(current_lvl.size() * 2);  // Оптимизация
+	//узлы для строго возрастающей последовательности ключей (один проход выделения)
+	template<typename Range>
+	static std::vector<std::unique_ptr<Node>> make_sorted_nodes(Range&& keys) {
+		std::vector<std::unique_ptr<Node>> nodes;
+		if constexpr (std::ranges::sized_range<Range>) {
+			nodes.reserve(std::ranges::size(keys));
+		}
+
+		for (auto&& key : keys) {
+			auto node = std::make_unique<Node>(key);
+			if (!nodes.empty() && !(nodes.back()->key < node->key)) {
+				throw std::invalid_argument(
+					"build_from_sorted requires strictly increasing keys");
+			}
+			nodes.push_back(std::move(node));
+		}
+		return nodes;
+	}
 
-			for (const Node* node : current_lvl) {
-				action(node->key);
+	//декартово дерево из узлов с возрастающими ключами за O(n)
+	static std::unique_ptr<Node> build_cartesian(std::vector<std::unique_ptr<Node>>& nodes) {
+		std::unique_ptr<Node> result;
 
-				if (node->left) next_lvl.push_back(node->left.get());
-				if (node->right) next_lvl.push_back(node->right.get());
+		// Правый край строящегося дерева: узлы с меньшим приоритетом, чем новый,
+		// уходят в его левое поддерево, сам он встаёт правым ребёнком оставшегося края
+		std::vector<Node*> right_spine;
+		for (auto& node : nodes) {
+			while (!right_spine.empty() && right_spine.back()->priority < node->priority) {
+				right_spine.pop_back();
 			}
 
-			current_lvl = std::move(next_lvl);
+			std::unique_ptr<Node>& slot = right_spine.empty() ? result : right_spine.back()->right;
+			Node* raw = node.get();
+			node->left = std::move(slot);
+			slot = std::move(node);
+			right_spine.push_back(raw);
 		}
+		recompute_augmentation(result.get());
+		return result;
 	}
 
 	//-------------- Общие служебные функции ---------//
@@ -428,6 +592,8 @@ protected:
 
 		auto new_node = std::make_unique<Node>(source->key);
 		new_node->priority = source->priority;  // копируем приоритет
+		static_cast<SubtreeSize<OrderStatistics>&>(*new_node) = *source;  // и дополнительные поля
+		static_cast<SubtreeAggregate<T, Aggregate>&>(*new_node) = *source;
 
 		new_node->left = clone(source->left.get());
 		new_node->right = clone(source->right.get());
@@ -435,110 +601,103 @@ protected:
 		return new_node;
 	}
 
-	std::unique_ptr<Node> insert_impl(std::unique_ptr<Node> node, const T& key) {
-		// Если дерево пустое - просто создаем новый узел
-		if (!node) {
-			++node_count;
-			return std::make_unique<Node>(key);
-		}	
-
-		// Разделяем
-		auto [left, right] = split(std::move(node), key);		
-
-		// Создаем и объединяем
-		auto new_node = std::make_unique<Node>(key);
-		++node_count;
-
-		// Объединяем левое дерево с новым элементом и потом все вместе с правым деревом
-		return merge(merge(std::move(left), std::move(new_node)), std::move(right));
-	}
-
-	//--------------Удаление --------------------//
-
-	//Специализации функции получения следующего ключа
-	// Для integral
-	template<typename U = T>
-		requires std::integral<U>
-	static U get_next_key(const U& key) {
-		if (key == std::numeric_limits<U>::max()) return key;
-		return key + 1;
-	}
-
-	// Для std::string
-	template<typename U = T>
-		requires std::same_as<U, std::string>
-	static U get_next_key(const U& key) {
-		if (key.empty()) return "\x00";
-
-		std::string result = key;
-		// Находим последний символ, который можно увеличить
-		for (auto it = result.rbegin(); it != result.rend(); ++it) {
-			if (*it != std::numeric_limits<unsigned char>::max()) {
-				++(*it);
-				// Обнуляем все символы справа
-				for (auto reset_it = result.rbegin(); reset_it != it; ++reset_it) {
-					*reset_it = '\x00';
-				}
-				return result;
+	//служебная функция вставки: подъём от пальца и спуск до места нового узла
+	//по приоритету, затем оставшееся поддерево делится по key прямо под новым узлом.
+	//Ключ перемещается в узел только при успешной вставке
+	template<typename K>
+	std::pair<const T*, bool> insert_impl(K&& key) {
+		const int priority = Node::generate_priority();
+
+		// Узлы с меньшим приоритетом окажутся под новым - поднимаемся выше них
+		finger.climb(root, key, [priority](const Node* node) { return node->priority < priority; });
+		std::unique_ptr<Node>* slot = &finger.descend(key,
+			[priority](const Node* node) { return node->priority > priority; });
+		if (*slot && (*slot)->priority > priority) {
+			return { &(*slot)->key, false };  // Дубликат выше места вставки
+		}
+
+		std::unique_ptr<Node> less, greater;  // будущие поддеревья нового узла
+		std::unique_ptr<Node>* left_hook = &less;
+		std::unique_ptr<Node>* right_hook = &greater;
+		std::unique_ptr<Node> rest = std::move(*slot);
+		AugmentFixup<Node, Augmented> hooked;   // узлы на крючках теряют часть поддерева
+
+		while (rest) {
+			const auto order = compare_keys(key, rest->key);
+			if (order != 0) hooked.touch(rest.get());
+			if (order > 0) {
+				*left_hook = std::move(rest);
+				left_hook = &(*left_hook)->right;
+				rest = std::move(*left_hook);
+			}
+			else if (order < 0) {
+				*right_hook = std::move(rest);
+				right_hook = &(*right_hook)->left;
+				rest = std::move(*right_hook);
+			}
+			else {
+				// Дубликат ниже места вставки: склеиваем половины обратно
+				*left_hook = std::move(rest->left);
+				*right_hook = std::move(rest->right);
+				hooked.apply();
+				const T* existing = &rest->key;
+				*slot = merge(merge(std::move(less), std::move(rest)), std::move(greater));
+				return { existing, false };
 			}
 		}
 
-		// Все символы на максимуме - добавляем нулевой байт
-		return key + '\x00';
+		hooked.apply();
+		auto new_node = std::make_unique<Node>(std::forward<K>(key), priority);
+		new_node->left = std::move(less);
+		new_node->right = std::move(greater);
+		update_augmentation(new_node.get());
+		const T* inserted = &new_node->key;
+		*slot = std::move(new_node);
+		if constexpr (Augmented) {
+			// Поля узлов над новым (палец хранит весь путь от корня)
+			for (size_t i = finger.depth(); i-- > 0;) {
+				update_augmentation(finger[i].get());
+			}
+		}
+		return { inserted, true };
 	}
 
-	// Для остальных типов - static_assert
-	template<typename U = T>
-	static U get_next_key(const U& key) {
-		static_assert(
-			std::is_integral_v<U> || std::is_same_v<U, std::string>,
-			"Treap requires get_next_key() for type T. "
-			"Either use int/long/std::string, or specialize get_next_key() for your type."
-			);
-		return key;
+	//вставка с учётом размера - общая часть insert(const T&) и insert(T&&)
+	template<typename K>
+	std::pair<const T*, bool> insert_key(K&& key) {
+		auto result = insert_impl(std::forward<K>(key));
+		if (result.second) ++node_count;
+		height_cache.invalidate();
+		return result;
 	}
 
-	//собственно реализация удаления
-	std::unique_ptr<Node> remove_impl(std::unique_ptr<Node> node, const T& key) {
-		// 1. Разделяем на < key и >= key
-		auto [left, middle_right] = split(std::move(node), key);
-
-		if (!middle_right) {
-			// key не найден
-			return std::move(left);
-		}
-
-		// Если key не максимальное значение в диапазоне
-		auto next_key = get_next_key(key);
-		if (next_key != key) {
-			// Разделяем middle_right на < next_key и >= next_key
-			// Поскольку middle_right содержит >= key, то < next_key будет только == key
-			auto [middle, right] = split(std::move(middle_right), next_key);
-
-			if (middle) {
-				--node_count;
-				// middle должен содержать key
+	//служебная функция удаления: на место узла встаёт merge его поддеревьев
+	bool remove_impl(const T& key) {
+		std::unique_ptr<Node>* slot = &root;
+		AugmentFixup<Node, Augmented> descent;  // узлы над удаляемым
+		while (*slot) {
+			Node* current = slot->get();
+			const auto order = compare_keys(key, current->key);
+			if (order < 0) {
+				descent.touch(current);
+				slot = &current->left;
+			}
+			else if (order > 0) {
+				descent.touch(current);
+				slot = &current->right;
+			}
+			else {
+				*slot = merge(std::move(current->left), std::move(current->right));
+				descent.apply();
+				return true;
 			}
-
-			return merge(std::move(left), std::move(right));
-		}
-
-		// 3. key максимальный - особый случай		
-		// key должен быть корнем middle_right (как наименьший в >= key)
-		if (middle_right->key == key) {
-			// Нашли! Удаляем корень
-			--node_count;
-			auto right = std::move(middle_right->right);
-			// middle_right (содержащий key) уничтожится
-			return merge(std::move(left), std::move(right));
-		}
-		else {
-			// key нет, хотя он максимальный
-			return merge(std::move(left), std::move(middle_right));
 		}
-	}		
+		return false;
+	}
 
 protected:
 	std::unique_ptr<Node> root = nullptr;
 	size_t node_count = 0;
+	HeightCache height_cache;  // высота, пересчитываемая после изменения формы
+	TreeFinger<Node> finger;   // путь к узлу последней вставки или contains_near
 };
\ No newline at end of file
@@ -0,0 +1,337 @@
+﻿#pragma once
+#include <iostream>
+#include <memory>
+#include <concepts>
+#include <queue>
+#include <vector>
+#include <span>
+#include <utility>
+#include "SearchTree.h"
+#include "KeyCompare.h"
+#include "TreeShape.h"
+#include "TreeNavigation.h"
+#include "TreeIterator.h"
+#include "TreeVisitor.h"
+#include "BatchLookup.h"
+
+/**
+ * CRTP-база деревьев: общий для всех реализаций код, который опирается
+ * только на поля root/node_count и узлы с key/left/right, - обходы,
+ * visitor-ы, навигация (в том числе пакетами отсортированных ключей),
+ * итераторы, профиль формы, печать, очистка и emplace.
+ *
+ * Виртуальных функций нет: вызовы разрешаются статически через Derived,
+ * поэтому работа с конкретным типом дерева не платит за косвенные вызовы.
+ * Derived объявляет TreeBase другом и при необходимости перекрывает хуки:
+ *   on_clear()             - сброс служебного состояния после clear();
+ *   print_node(os, node)   - подпись узла в print().
+ */
+template<typename Derived, std::totally_ordered T>
+class TreeBase {
+public:
+	using key_type = T;
+	using value_type = T;
+
+	//очистка дерева (итеративно)
+	void clear() {
+		destroy_subtree(std::move(self().root));
+		self().node_count = 0;
+		self().on_clear();
+	}
+
+	//построение ключа из аргументов и вставка его перемещением (insert(T&&)):
+	//ключ не копируется. Возвращает то же, что insert
+	template<typename... Args>
+		requires std::constructible_from<T, Args&&...>
+	std::pair<const T*, bool> emplace(Args&&... args) {
+		return self().insert(T(std::forward<Args>(args)...));
+	}
+
+	//--------- Состояние -------//
+	//проверка на пустоту
+	bool empty() const {
+		return !self().root;
+	}
+
+	//размер
+	size_t size() const {
+		return self().node_count;
+	}
+
+	// --------- Публичные методы обходов --------- //
+	std::vector<T> inorder() const {
+		return collect([this](auto&& action) { inorder_impl(action); });
+	}
+
+	std::vector<T> preorder() const {
+		return collect([this](auto&& action) { preorder_impl(action); });
+	}
+
+	std::vector<T> postorder() const {
+		return collect([this](auto&& action) { postorder_impl(action); });
+	}
+
+	std::vector<T> level_order() const {
+		return collect([this](auto&& action) { level_order_impl(action); });
+	}
+
+	// --------- Visitor методы --------- //
+	//статический вызов visitor без std::function; visitor может вернуть false,
+	//чтобы остановить обход. Результат - true, если обход дошёл до конца
+	template<typename Visitor> requires KeyVisitor<Visitor, T>
+	bool visit_inorder(Visitor&& visitor) const {
+		return inorder_impl(visitor);
+	}
+
+	template<typename Visitor> requires KeyVisitor<Visitor, T>
+	bool visit_preorder(Visitor&& visitor) const {
+		return preorder_impl(visitor);
+	}
+
+	template<typename Visitor> requires KeyVisitor<Visitor, T>
+	bool visit_postorder(Visitor&& visitor) const {
+		return postorder_impl(visitor);
+	}
+
+	template<typename Visitor> requires KeyVisitor<Visitor, T>
+	bool visit_level_order(Visitor&& visitor) const {
+		return level_order_impl(visitor);
+	}
+
+	//--------- Упорядоченная навигация -------//
+	//O(высоты) без выделения памяти; nullptr, если подходящего ключа нет.
+	//K - T или сравнимый с ним тип запроса (std::string_view для строк)
+	template<typename K = T> requires LookupKey<K, T>
+	const T* lower_bound(const K& key) const {
+		return lower_bound_in(self().root.get(), key);
+	}
+
+	template<typename K = T> requires LookupKey<K, T>
+	const T* upper_bound(const K& key) const {
+		return upper_bound_in(self().root.get(), key);
+	}
+
+	template<typename K = T> requires LookupKey<K, T>
+	const T* floor(const K& key) const {
+		return floor_in(self().root.get(), key);
+	}
+
+	template<typename K = T> requires LookupKey<K, T>
+	const T* ceiling(const K& key) const {
+		return lower_bound_in(self().root.get(), key);
+	}
+
+	//ключи из [lo, hi) по возрастанию, O(высоты + k)
+	template<typename Visitor> requires KeyVisitor<Visitor, T>
+	bool visit_range(const T& lo, const T& hi, Visitor&& visitor) const {
+		return visit_range_in(self().root.get(), lo, hi, visitor);
+	}
+
+	//--------- Отсортированные пакеты -------//
+	//keys по возрастанию (иначе std::invalid_argument); один проход по дереву,
+	//соседние ключи используют общий префикс пути - O(m log(n/m)) сравнений
+	void contains_sorted_batch(std::span<const T> keys, std::span<bool> out) const {
+		contains_sorted_in(self().root.get(), keys, out);
+	}
+
+	void lower_bound_batch(std::span<const T> keys, std::span<const T*> out) const {
+		lower_bound_sorted_in(self().root.get(), keys, out);
+	}
+
+	//--------- Итераторы -------//
+	//ключи по возрастанию без выделения памяти (см. TreeIterator.h);
+	//тип - Derived::iterator
+	auto begin() const {
+		return TreeIterator<typename Derived::Node>::begin(self().root.get());
+	}
+
+	auto end() const {
+		return TreeIterator<typename Derived::Node>::end(self().root.get());
+	}
+
+	//--------- Профиль формы -------//
+	//по требованию: гистограмма глубин, средняя и взвешенная длина пути
+	ShapeProfile shape_profile() const {
+		return profile_shape(self().root.get());
+	}
+
+	template<typename Weight>
+	ShapeProfile shape_profile(Weight&& weight) const {
+		return profile_shape(self().root.get(), std::forward<Weight>(weight));
+	}
+
+	//--------- Печать -------//
+	void print(std::ostream& os = std::cout) const {
+		using Node = typename Derived::Node;
+
+		if (!self().root) {
+			os << "[empty]\n";
+			return;
+		}
+
+		std::queue<const Node*> q;
+		q.push(self().root.get());
+		int level = 0;
+
+		while (!q.empty()) {
+			int level_size = q.size();
+			os << "Level " << level << ": ";
+
+			for (int i = 0; i < level_size; ++i) {
+				const Node* current = q.front();
+				q.pop();
+
+				self().print_node(os, current);
+
+				// Показываем связи
+				if (current->left || current->right) {
+					os << "[";
+					if (current->left) os << "L:" << current->left->key;
+					if (current->left && current->right) os << ",";
+					if (current->right) os << "R:" << current->right->key;
+					os << "]";
+				}
+				os << "  ";
+
+				if (current->left) q.push(current->left.get());
+				if (current->right) q.push(current->right.get());
+			}
+			os << "\n";
+			level++;
+		}
+	}
+
+protected:
+	// База без состояния; удаление только через Derived
+	TreeBase() = default;
+	~TreeBase() = default;
+
+	Derived& self() {
+		return static_cast<Derived&>(*this);
+	}
+
+	const Derived& self() const {
+		return static_cast<const Derived&>(*this);
+	}
+
+	// --------- Хуки по умолчанию --------- //
+	void on_clear() {}
+
+	template<typename Node>
+	void print_node(std::ostream& os, const Node* node) const {
+		os << node->key;
+	}
+
+	// --------- Шаблонные реализации обходов --------- //
+	template<typename Action>
+	bool inorder_impl(Action&& action) const {
+		using Node = typename Derived::Node;
+		if (!self().root) return true;
+
+		InlineStack<const Node*> stack;
+		const Node* current = self().root.get();
+
+		while (current || !stack.empty()) {
+			while (current) {
+				stack.push(current);
+				current = current->left.get();
+			}
+
+			current = stack.pop();
+			if (!visit_key(action, current->key)) return false;
+
+			current = current->right.get();
+		}
+		return true;
+	}
+
+	template<typename Action>
+	bool preorder_impl(Action&& action) const {
+		using Node = typename Derived::Node;
+		if (!self().root) return true;
+
+		InlineStack<const Node*> stack;
+		stack.push(self().root.get());
+
+		while (!stack.empty()) {
+			const Node* current = stack.pop();
+			if (!visit_key(action, current->key)) return false;
+
+			if (current->right) stack.push(current->right.get());
+			if (current->left) stack.push(current->left.get());
+		}
+		return true;
+	}
+
+	template<typename Action>
+	bool postorder_impl(Action&& action) const {
+		using Node = typename Derived::Node;
+		if (!self().root) return true;
+
+		// Один стек глубиной в высоту дерева: узел выводится, когда
+		// из его правого поддерева уже вернулись (или его нет)
+		InlineStack<const Node*> stack;
+		const Node* current = self().root.get();
+		const Node* last_visited = nullptr;
+
+		while (current || !stack.empty()) {
+			while (current) {
+				stack.push(current);
+				current = current->left.get();
+			}
+
+			const Node* top = stack.pop();
+			if (top->right && top->right.get() != last_visited) {
+				stack.push(top);
+				current = top->right.get();
+			}
+			else {
+				if (!visit_key(action, top->key)) return false;
+				last_visited = top;
+			}
+		}
+		return true;
+	}
+
+	template<typename Action>
+	bool level_order_impl(Action&& action) const {
+		using Node = typename Derived::Node;
+		if (!self().root) return true;
+
+		std::vector<const Node*> current_lvl;
+		current_lvl.push_back(self().root.get());
+
+		while (!current_lvl.empty()) {
+			std::vector<const Node*> next_lvl;
+			next_lvl.reserve(current_lvl.size() * 2);
+
+			for (const Node* node : current_lvl) {
+				if (!visit_key(action, node->key)) return false;
+
+				if (node->left) next_lvl.push_back(node->left.get());
+				if (node->right) next_lvl.push_back(node->right.get());
+			}
+
+			current_lvl = std::move(next_lvl);
+		}
+		return true;
+	}
+
+private:
+	// Ключи в порядке обхода traverse, с резервом под весь размер
+	template<typename Traverse>
+	std::vector<T> collect(Traverse&& traverse) const {
+		std::vector<T> result;
+		if (self().root) {
+			result.reserve(self().node_count);
+			traverse([&](const T& key) { result.emplace_back(key); });
+		}
+		return result;
+	}
+};
+
+template<typename Derived, std::totally_ordered T>
+std::ostream& operator<<(std::ostream& os, const TreeBase<Derived, T>& tree) {
+	tree.print(os);
+	return os;
+}
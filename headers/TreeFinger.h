@@ -0,0 +1,124 @@
+﻿#pragma once
+#include <memory>
+#include "KeyCompare.h"
+#include <vector>
+#include <cstddef>
+
+// Палец для деревьев на unique_ptr без ссылок на родителя: сохранённый путь
+// от корня к узлу последней операции. Для каждого слота пути запомнены
+// ближайшие предки слева и справа - границы ключей его поддерева, поэтому
+// следующий поиск поднимается только до поддерева, которое может содержать
+// ключ, и спускается оттуда: O(расстояния), а не O(глубины). Для возрастающего
+// потока ключей (дописывание справа) это O(1) на операцию.
+//
+// Путь указывает внутрь узлов: дерево сбрасывает палец (reset) при каждом
+// изменении формы, прошедшем мимо него. Копии начинают с пустого пальца.
+template<typename Node>
+class TreeFinger {
+public:
+	struct Frame {
+		std::unique_ptr<Node>* slot;  // владелец узла на пути
+		const Node* lo;  // ключи поддерева > lo->key (nullptr - без границы)
+		const Node* hi;  // ключи поддерева < hi->key
+	};
+
+	TreeFinger() = default;
+	TreeFinger(const TreeFinger&) noexcept {}
+	TreeFinger& operator=(const TreeFinger&) noexcept {
+		reset();
+		return *this;
+	}
+
+	void reset() {
+		frames.clear();
+	}
+
+	// Подъём до ближайшего слота, в поддереве которого может лежать key.
+	// skip(node) поднимает и выше узлов, под которыми остановиться нельзя
+	// (у декартова дерева - выше узлов с меньшим приоритетом)
+	template<typename K, typename Skip>
+	std::unique_ptr<Node>& climb(std::unique_ptr<Node>& root, const K& key, Skip&& skip) {
+		if (frames.empty() || frames.front().slot != &root) {
+			frames.assign(1, Frame{ &root, nullptr, nullptr });
+		}
+		// Пустой слот в конце пути (после промаха поиска) сам по себе ничего
+		// не ограничивает: skip должен проверяться у его родителя, иначе
+		// новый узел повиснет листом под узлом, который ему уступает
+		if (frames.size() > 1 && !*frames.back().slot) {
+			frames.pop_back();
+		}
+		auto fits = [&](const Frame& frame) {
+			return covers(frame, key) && !(*frame.slot && skip(frame.slot->get()));
+		};
+
+		// Условие монотонно вдоль пути (верно для префикса), поэтому после
+		// проверки нижнего слота глубина ищется двоичным поиском: далёкий
+		// ключ не проходит весь путь снизу вверх
+		if (!fits(frames.back())) {
+			size_t lo = 0, hi = frames.size() - 1;  // fits(lo) (корень), !fits(hi)
+			while (hi - lo > 1) {
+				size_t mid = lo + (hi - lo) / 2;
+				(mid == 0 || fits(frames[mid]) ? lo : hi) = mid;
+			}
+			frames.erase(frames.begin() + lo + 1, frames.end());
+		}
+		return *frames.back().slot;
+	}
+
+	template<typename K>
+	std::unique_ptr<Node>& climb(std::unique_ptr<Node>& root, const K& key) {
+		return climb(root, key, [](const Node*) { return false; });
+	}
+
+	// Спуск от текущего слота к key, пока go(node) разрешает идти ниже узла.
+	// Возвращается слот узла с key или слот, где спуск остановился
+	template<typename K, typename Go>
+	std::unique_ptr<Node>& descend(const K& key, Go&& go) {
+		Frame top = frames.back();
+		while (Node* node = top.slot->get()) {
+			if (!go(node)) break;
+			const auto order = compare_keys(key, node->key);
+			if (order < 0) {
+				top = Frame{ &node->left, top.lo, node };
+			}
+			else if (order > 0) {
+				top = Frame{ &node->right, node, top.hi };
+			}
+			else {
+				break;
+			}
+			frames.push_back(top);
+		}
+		return *top.slot;
+	}
+
+	// Слот узла с key или пустой слот, куда он встанет
+	template<typename K>
+	std::unique_ptr<Node>& seek(std::unique_ptr<Node>& root, const K& key) {
+		climb(root, key);
+		return descend(key, [](const Node*) { return true; });
+	}
+
+	// Путь обрезается до глубины depth: ниже форма изменилась,
+	// но границы самого слота остались прежними
+	void truncate(size_t depth) {
+		frames.erase(frames.begin() + depth + 1, frames.end());
+	}
+
+	// Глубина текущего слота (корень - 0)
+	size_t depth() const {
+		return frames.size() - 1;
+	}
+
+	std::unique_ptr<Node>& operator[](size_t depth) const {
+		return *frames[depth].slot;
+	}
+
+private:
+	template<typename K>
+	static bool covers(const Frame& frame, const K& key) {
+		return (!frame.lo || frame.lo->key < key) && (!frame.hi || key < frame.hi->key);
+	}
+
+	std::vector<Frame> frames;
+};
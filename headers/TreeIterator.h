@@ -0,0 +1,152 @@
+﻿#pragma once
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+// Двунаправленный итератор по ключам в порядке возрастания для узлов
+// с полями key/left/right. Путь от корня хранится во встроенном массиве,
+// поэтому итератор не выделяет память: шаг - O(1) амортизированно.
+// Узлы глубже PATH_CAPACITY (вырожденные деревья) не помещаются в путь,
+// тогда соседний ключ ищется спуском от корня за O(высоты).
+// Любое изменение дерева (включая splay при поиске) делает итератор недействительным.
+template<typename Node>
+class TreeIterator {
+public:
+	using iterator_category = std::bidirectional_iterator_tag;
+	using value_type = std::remove_cvref_t<decltype(std::declval<const Node&>().key)>;
+	using difference_type = std::ptrdiff_t;
+	using pointer = const value_type*;
+	using reference = const value_type&;
+
+	static constexpr size_t PATH_CAPACITY = 48;
+
+	TreeIterator() = default;
+
+	// Итератор на минимальный ключ
+	static TreeIterator begin(const Node* root) {
+		TreeIterator it(root);
+		if (root) it.descend(root, true);
+		return it;
+	}
+
+	// Итератор за последним ключом; -- от него ведёт к максимуму
+	static TreeIterator end(const Node* root) {
+		return TreeIterator(root);
+	}
+
+	reference operator*() const {
+		return node->key;
+	}
+
+	pointer operator->() const {
+		return &node->key;
+	}
+
+	TreeIterator& operator++() {
+		step(true);
+		return *this;
+	}
+
+	TreeIterator operator++(int) {
+		TreeIterator old = *this;
+		step(true);
+		return old;
+	}
+
+	TreeIterator& operator--() {
+		step(false);
+		return *this;
+	}
+
+	TreeIterator operator--(int) {
+		TreeIterator old = *this;
+		step(false);
+		return old;
+	}
+
+	friend bool operator==(const TreeIterator& a, const TreeIterator& b) {
+		return a.node == b.node;
+	}
+
+private:
+	explicit TreeIterator(const Node* tree_root) : root(tree_root) {}
+
+	static const Node* child(const Node* parent, bool left) {
+		return left ? parent->left.get() : parent->right.get();
+	}
+
+	// Предки сверх PATH_CAPACITY не сохраняются, но учитываются в depth
+	void push(const Node* ancestor) {
+		if (depth < PATH_CAPACITY) path[depth] = ancestor;
+		++depth;
+	}
+
+	// Спуск от start до минимума (to_min) или максимума его поддерева
+	void descend(const Node* start, bool to_min) {
+		node = start;
+		while (const Node* next = child(node, to_min)) {
+			push(node);
+			node = next;
+		}
+	}
+
+	// Переход к следующему (forward) или предыдущему ключу
+	void step(bool forward) {
+		if (!node) {
+			// Из end() назад - к максимуму
+			depth = 0;
+			if (!forward && root) descend(root, false);
+			return;
+		}
+
+		if (const Node* next = child(node, !forward)) {
+			push(node);
+			descend(next, forward);
+			return;
+		}
+
+		if (depth <= PATH_CAPACITY) {
+			// Поднимаемся до первого предка, в чьё левое (правое) поддерево спускались
+			const Node* from = node;
+			while (depth > 0) {
+				const Node* parent = path[--depth];
+				if (child(parent, forward) == from) {
+					node = parent;
+					return;
+				}
+				from = parent;
+			}
+			node = nullptr;
+			return;
+		}
+
+		seek_neighbor(node->key, forward);
+	}
+
+	// Поиск соседнего ключа от корня с восстановлением пути до него
+	void seek_neighbor(const value_type& key, bool forward) {
+		const Node* found = nullptr;
+		size_t found_depth = 0;
+
+		depth = 0;
+		for (const Node* current = root; current; ) {
+			bool beyond = forward ? key < current->key : current->key < key;
+			if (beyond) {
+				found = current;
+				found_depth = depth;
+			}
+			push(current);
+			current = child(current, forward == beyond);
+		}
+
+		node = found;
+		depth = found ? found_depth : 0;
+	}
+
+	const Node* root = nullptr;
+	const Node* node = nullptr;  // nullptr - позиция end()
+	size_t depth = 0;            // число предков node (в path - первые PATH_CAPACITY)
+	std::array<const Node*, PATH_CAPACITY> path{};
+};
@@ -0,0 +1,84 @@
+﻿#pragma once
+#include "TreeShape.h"
+#include "KeyCompare.h"
+#include "TreeVisitor.h"
+
+// Упорядоченная навигация по узлам с полями key/left/right: один спуск
+// от корня, без выделения памяти. Возвращается указатель на ключ в узле
+// (nullptr, если подходящего ключа нет); он действителен до изменения дерева.
+// Искомый key - ключ дерева или сравнимый с ним тип запроса.
+
+// Первый ключ >= key
+template<typename Node, typename K>
+auto lower_bound_in(const Node* node, const K& key) {
+	const decltype(Node::key)* result = nullptr;
+	while (node) {
+		if (node->key < key) {
+			node = node->right.get();
+		}
+		else {
+			result = &node->key;
+			node = node->left.get();
+		}
+	}
+	return result;
+}
+
+// Первый ключ > key
+template<typename Node, typename K>
+auto upper_bound_in(const Node* node, const K& key) {
+	const decltype(Node::key)* result = nullptr;
+	while (node) {
+		if (key < node->key) {
+			result = &node->key;
+			node = node->left.get();
+		}
+		else {
+			node = node->right.get();
+		}
+	}
+	return result;
+}
+
+// Последний ключ <= key
+template<typename Node, typename K>
+auto floor_in(const Node* node, const K& key) {
+	const decltype(Node::key)* result = nullptr;
+	while (node) {
+		if (key < node->key) {
+			node = node->left.get();
+		}
+		else {
+			result = &node->key;
+			node = node->right.get();
+		}
+	}
+	return result;
+}
+
+// Обход ключей из [lo, hi) по возрастанию за O(высоты + k): поддеревья
+// левее lo не посещаются, обход прерывается на первом ключе >= hi
+// (или когда visitor вернёт false - тогда результат false).
+// Стек встроенный - куча нужна только для вырожденных деревьев глубже 128.
+template<typename Node, typename T, typename Visitor>
+bool visit_range_in(const Node* node, const T& lo, const T& hi, Visitor&& visitor) {
+	InlineStack<const Node*> stack;
+
+	while (true) {
+		while (node) {
+			if (node->key < lo) {
+				node = node->right.get();  // узел и его левое поддерево левее диапазона
+			}
+			else {
+				stack.push(node);
+				node = node->left.get();
+			}
+		}
+		if (stack.empty()) return true;
+
+		node = stack.pop();
+		if (!(node->key < hi)) return true;
+		if (!visit_key(visitor, node->key)) return false;
+		node = node->right.get();
+	}
+}
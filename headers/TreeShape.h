@@ -0,0 +1,205 @@
+﻿#pragma once
+#include <iostream>
+#include <array>
+#include <vector>
+#include <utility>
+#include <memory>
+#include <algorithm>
+#include <cstddef>
+
+// Стек со встроенным буфером: первые N элементов хранятся внутри объекта,
+// куча используется только для более глубоких (вырожденных) деревьев
+template<typename V, size_t N = 128>
+class InlineStack {
+public:
+	void push(const V& value) {
+		if (count < N) {
+			buffer[count] = value;
+		}
+		else {
+			overflow.push_back(value);
+		}
+		++count;
+	}
+
+	V pop() {
+		--count;
+		if (count < N) return buffer[count];
+
+		V value = overflow.back();
+		overflow.pop_back();
+		return value;
+	}
+
+	const V& top() const {
+		return count <= N ? buffer[count - 1] : overflow.back();
+	}
+
+	bool empty() const {
+		return count == 0;
+	}
+
+	size_t size() const {
+		return count;
+	}
+
+private:
+	std::array<V, N> buffer;
+	std::vector<V> overflow;
+	size_t count = 0;
+};
+
+// Профиль формы дерева
+struct ShapeProfile {
+	// Узлы глубже MAX_LEVELS - 1 учитываются в последней ячейке гистограммы
+	static constexpr size_t MAX_LEVELS = 128;
+
+	size_t nodes = 0;
+	int height = -1;
+	size_t path_length = 0;           // внутренняя длина пути: сумма глубин узлов
+	double total_weight = 0.0;
+	double weighted_path_length = 0.0; // сумма weight(key) * (depth + 1)
+	std::array<size_t, MAX_LEVELS> depth_histogram{};
+
+	// Средняя глубина узла
+	double average_depth() const {
+		return nodes ? static_cast<double>(path_length) / nodes : 0.0;
+	}
+
+	// Ожидаемое число сравнений при успешном поиске с данными весами
+	double average_weighted_cost() const {
+		return total_weight > 0.0 ? weighted_path_length / total_weight : 0.0;
+	}
+
+	void print(std::ostream& os = std::cout) const {
+		os << "nodes=" << nodes << ", height=" << height
+			<< ", avg depth=" << average_depth()
+			<< ", weighted cost=" << average_weighted_cost() << "\n";
+
+		size_t levels = std::min(static_cast<size_t>(height + 1), MAX_LEVELS);
+		for (size_t level = 0; level < levels; ++level) {
+			os << "  depth " << level << ": " << depth_histogram[level] << "\n";
+		}
+	}
+};
+
+// Профиль поддерева за один обход в глубину; weight(key) задаёт частоту обращений
+template<typename Node, typename Weight>
+ShapeProfile profile_shape(const Node* root, Weight&& weight) {
+	ShapeProfile profile;
+	if (!root) return profile;
+
+	InlineStack<std::pair<const Node*, int>> stack;
+	stack.push({ root, 0 });
+
+	while (!stack.empty()) {
+		auto [node, depth] = stack.pop();
+
+		double w = static_cast<double>(weight(node->key));
+		++profile.nodes;
+		profile.height = std::max(profile.height, depth);
+		profile.path_length += depth;
+		profile.total_weight += w;
+		profile.weighted_path_length += w * (depth + 1);
+		++profile.depth_histogram[std::min(static_cast<size_t>(depth), ShapeProfile::MAX_LEVELS - 1)];
+
+		if (node->right) stack.push({ node->right.get(), depth + 1 });
+		if (node->left) stack.push({ node->left.get(), depth + 1 });
+	}
+
+	return profile;
+}
+
+// Профиль с единичными весами
+template<typename Node>
+ShapeProfile profile_shape(const Node* root) {
+	return profile_shape(root, [](const auto&) { return 1.0; });
+}
+
+// Высота поддерева (-1 для пустого) без выделения памяти на сбалансированных деревьях
+template<typename Node>
+int subtree_height(const Node* root) {
+	if (!root) return -1;
+
+	int height = 0;
+	InlineStack<std::pair<const Node*, int>> stack;
+	stack.push({ root, 0 });
+
+	while (!stack.empty()) {
+		auto [node, depth] = stack.pop();
+		height = std::max(height, depth);
+
+		if (node->right) stack.push({ node->right.get(), depth + 1 });
+		if (node->left) stack.push({ node->left.get(), depth + 1 });
+	}
+
+	return height;
+}
+
+// Размер меньшего из двух поддеревьев: обходы идут попеременно и останавливаются,
+// как только одно из поддеревьев исчерпано, O(min(|a|, |b|)).
+// Второй элемент - true, если меньшим оказалось a.
+template<typename Node>
+std::pair<size_t, bool> smaller_subtree_size(const Node* a, const Node* b) {
+	InlineStack<const Node*> stack_a, stack_b;
+	if (a) stack_a.push(a);
+	if (b) stack_b.push(b);
+
+	size_t count = 0;
+	while (!stack_a.empty() && !stack_b.empty()) {
+		for (auto* stack : { &stack_a, &stack_b }) {
+			const Node* node = stack->pop();
+			if (node->left) stack->push(node->left.get());
+			if (node->right) stack->push(node->right.get());
+		}
+		++count;
+	}
+
+	// Оба обхода сделали по count шагов; меньшее поддерево то, что закончилось
+	return { count, stack_a.empty() };
+}
+
+// Удаление поддерева без рекурсии; возвращает число удалённых узлов
+template<typename Node>
+size_t destroy_subtree(std::unique_ptr<Node> root) {
+	size_t count = 0;
+	InlineStack<Node*> stack;
+	if (root) stack.push(root.release());
+
+	while (!stack.empty()) {
+		std::unique_ptr<Node> node(stack.pop());
+		if (node->left) stack.push(node->left.release());
+		if (node->right) stack.push(node->right.release());
+		++count;
+	}
+
+	return count;
+}
+
+// Кэш высоты для деревьев, не хранящих её в узлах.
+// Вставка листа без поворотов поднимает значение на месте, прочие
+// структурные изменения сбрасывают кэш; height() пересчитывает его лениво.
+class HeightCache {
+public:
+	template<typename Compute>
+	int get(Compute&& compute) const {
+		if (!valid) {
+			value = compute();
+			valid = true;
+		}
+		return value;
+	}
+
+	// Новый лист на глубине depth, остальные узлы не сдвигались
+	void leaf_inserted(int depth) {
+		if (valid) value = std::max(value, depth);
+	}
+
+	void invalidate() {
+		valid = false;
+	}
+
+private:
+	mutable int value = -1;
+	mutable bool valid = false;
+};
@@ -9,11 +9,59 @@
 #include <set>
 #include <functional>
 #include <concepts>
+#include <stdexcept>
+#include <iterator>
+#include <ranges>
+#include <span>
+#include <memory>
+#include <type_traits>
+#include <string>
+#include <string_view>
 #include "OptimalBST.h"
 #include "SplayTree.h"
 #include "OptimalTreap.h"
+#include "MultiSplayTree.h"
+#include "FrozenTree.h"
+
+// Ключи для тестов: at(i) строго возрастает вместе с i,
+// missing(key) не совпадает ни с одним at(i)
+template<typename T>
+struct TestKeys;
+
+template<std::integral T>
+struct TestKeys<T> {
+	static T at(size_t i) {
+		return static_cast<T>(i);
+	}
+
+	static T missing(const T& key) {
+		return static_cast<T>(-key - 1);
+	}
+};
+
+// Строки одной длины: номер с шагом 7919, чтобы далёкие ключи различались
+// уже в первых байтах, а соседние - только дальше (оба случая сравнения
+// PrefixString), и общий хвост: ключ длиннее буфера малой строки и живёт в куче
+template<typename T>
+	requires std::constructible_from<T, std::string> && std::convertible_to<const T&, std::string_view>
+struct TestKeys<T> {
+	static T at(size_t i) {
+		std::string digits = std::to_string(i * 7919);
+		return T(std::string(12 - digits.size(), '0') + digits + "/test-key");
+	}
+
+	static T missing(const T& key) {
+		return T(std::string(std::string_view(key)) + "~");
+	}
+};
 
-template <std::integral T, std::derived_from<ITree<T>> Tree>
+template<typename T>
+concept TestableKey = requires(size_t i, const T& key) {
+	{ TestKeys<T>::at(i) } -> std::same_as<T>;
+	{ TestKeys<T>::missing(key) } -> std::same_as<T>;
+};
+
+template <TestableKey T, SearchTree<T> Tree>
 class TreeTest {
 public:
 
@@ -53,6 +101,31 @@ public:
 		}
 		else stress_test(std::min(size, (size_t)5000));
 
+		// 6. Массовое построение из отсортированных данных (если дерево его поддерживает)
+		if constexpr (requires(Tree& t, const std::vector<T>& v) { t.build_from_sorted(v); }) {
+			bulk_build_test(size);
+		}
+
+		// 7. Операции над множествами (если дерево их поддерживает)
+		if constexpr (requires(Tree& t, Tree o) { t.union_with(std::move(o)); }) {
+			set_operations_test(size);
+		}
+
+		// 8. Разделение, соединение и удаление диапазона (если дерево их поддерживает)
+		if constexpr (requires(Tree& t, const T& k) { t.split(k); t.erase_range(k, k); }) {
+			split_join_test(size);
+		}
+
+		// 9. Порядковые статистики (если дерево хранит размеры поддеревьев)
+		if constexpr (requires(const Tree& t, const T& k) { t.rank(k); t.select(0); t.count_range(k, k); }) {
+			order_statistics_test(size);
+		}
+
+		// 10. Агрегаты поддеревьев (если задана политика агрегата)
+		if constexpr (requires(const Tree& t, const T& k) { t.aggregate(k, k); t.total_aggregate(); }) {
+			aggregate_test(size);
+		}
+
 		std::cout << "\n========================================\n";
 		std::cout << "ALL TESTS PASSED SUCCESSFULLY!\n";
 		std::cout << "========================================\n";
@@ -60,6 +133,11 @@ public:
 
 private:
 
+	// Ключ теста с номером i (ключи возрастают вместе с номером)
+	static T test_key(size_t i) {
+		return TestKeys<T>::at(i);
+	}
+
 	// ==================== 1. Граничные случаи ====================
 	static void test_edge_cases() {
 		std::cout << "1. EDGE CASES TEST\n";
@@ -71,50 +149,83 @@ private:
 		assert(tree.empty());
 		assert(tree.size() == 0);
 		assert(tree.height() == -1); // предполагаем height(empty) = -1
-		assert(!tree.contains(0));
+		assert(!tree.contains(test_key(0)));
 		assert(tree.inorder().empty());
 		std::cout << "+ Empty tree checks passed\n";
 
 		// 1.2 Один элемент
-		tree.insert(42);
+		tree.insert(test_key(42));
 		assert(!tree.empty());
 		assert(tree.size() == 1);
 		assert(tree.height() == 0);
-		assert(tree.contains(42));
-		assert(!tree.contains(0));
-		assert(tree.inorder() == std::vector<T>{42});
+		assert(tree.contains(test_key(42)));
+		assert(!tree.contains(test_key(0)));
+		assert(tree.inorder() == std::vector<T>{ test_key(42) });
 		std::cout << "+ Single element checks passed\n";
 
 		// 1.3 Дубликаты не добавляются
-		tree.insert(42); // Дубликат
+		tree.insert(test_key(42)); // Дубликат
 		assert(tree.size() == 1);
 		std::cout << "+ Duplicate prevention check passed\n";
 
+		// 1.3а Вставка возвращает указатель на ключ и признак добавления
+		[[maybe_unused]] auto [added, was_added] = tree.insert(test_key(7));
+		assert(was_added && added && *added == test_key(7));
+		[[maybe_unused]] auto [again, added_again] = tree.emplace(test_key(7));
+		assert(!added_again && again == added && tree.size() == 2);
+		tree.remove(test_key(7));
+		std::cout << "+ Insert status and emplace checks passed\n";
+
+		// 1.3б emplace идёт через insert самого дерева (перестройки, подъём
+		// в корень), а не через insert простого BST, который на возрастающих
+		// ключах строит цепочку высоты shape_count - 1
+		const size_t shape_count = 2000;
+		const int chain = static_cast<int>(shape_count) - 1;
+		Tree emplaced, inserted;
+		for (size_t i = 0; i < shape_count; i++) {
+			emplaced.emplace(test_key(i));
+			inserted.insert(test_key(i));
+		}
+		// Рандомизированное дерево изредка строит цепочку и само - пересобираем
+		for (int attempt = 0; attempt < 2 && emplaced.height() == chain && inserted.height() != chain; attempt++) {
+			emplaced.clear();
+			for (size_t i = 0; i < shape_count; i++) emplaced.emplace(test_key(i));
+		}
+		assert(emplaced.inorder() == inserted.inorder());
+		// Детерминированные деревья совпадают по высоте, у рандомизированных
+		// высоты разные, но цепочки нет там, где её не строит insert
+		assert(emplaced.height() == inserted.height() || emplaced.height() < chain || inserted.height() == chain);
+		if constexpr (std::is_same_v<Tree, SplayTree<T>>) {
+			assert(emplaced.preorder().front() == test_key(shape_count - 1));  // последний ключ в корне
+		}
+		std::cout << "+ Emplace shape matches insert (height " << emplaced.height()
+			<< " vs " << inserted.height() << ")\n";
+
 		// 1.4 Удаление единственного элемента
-		tree.remove(42);
+		tree.remove(test_key(42));
 		assert(tree.empty());
 		assert(tree.size() == 0);
 		assert(tree.height() == -1);
-		assert(!tree.contains(42));
+		assert(!tree.contains(test_key(42)));
 		std::cout << "+ Single element removal passed\n";
 
 		// 1.5 Удаление несуществующего элемента
-		tree.remove(999);
+		tree.remove(test_key(999));
 		assert(tree.empty()); // Должно остаться пустым
 		std::cout << "+ Non-existent removal passed\n";
 
 		// 1.6 Быстрое добавление/удаление
-		for (int i = 0; i < 100; i++) {
-			tree.insert(i);
-			tree.remove(i);
+		for (size_t i = 0; i < 100; i++) {
+			tree.insert(test_key(i));
+			tree.remove(test_key(i));
 			assert(tree.empty());
 		}
 		std::cout << "+ Rapid insert/remove cycle passed\n";
 
 		// 1.7 Очистка
-		tree.insert(1);
-		tree.insert(2);
-		tree.insert(3);
+		tree.insert(test_key(1));
+		tree.insert(test_key(2));
+		tree.insert(test_key(3));
 		tree.clear();
 		assert(tree.empty());
 		assert(tree.size() == 0);
@@ -133,8 +244,8 @@ private:
 		std::vector<T> random_data(size);
 
 		for (size_t i = 0; i < size; i++) {
-			sorted_data[i] = static_cast<T>(i);
-			random_data[i] = static_cast<T>(i);
+			sorted_data[i] = test_key(i);
+			random_data[i] = test_key(i);
 		}
 
 		std::random_device rd;
@@ -177,7 +288,8 @@ private:
 
 		// 2.4а Дополнительные тесты поиска случайных элементов для splay
 		if constexpr (std::is_same_v<Tree, SplayTree<T>> || 
-			std::is_same_v<Tree, OptimalTreap<T>>) {
+			std::is_same_v<Tree, OptimalTreap<T>> ||
+			std::is_same_v<Tree, MultiSplayTree<T>>) {
 
 			std::cout << "\n2.5a 10 percent find_and_splay tests:\n";
 			test_random_splay_find_10_percent(sorted_tree, sorted_data, "Sorted tree");
@@ -192,6 +304,20 @@ private:
 			warmup_test(random_tree, size / 2, size / 100, "Random tree", size);
 		}
 
+		// 2.4б Упорядоченная навигация
+		std::cout << "\n2.4b Ordered navigation:\n";
+		test_ordered_navigation(random_tree, size);
+
+		// 2.4в Неизменяемый снимок для пакетного поиска
+		std::cout << "\n2.4c Frozen snapshot:\n";
+		test_frozen_snapshot(random_tree, size);
+
+		// 2.4г Поиск и вставка от пальца (если дерево его хранит)
+		if constexpr (requires(Tree& t, const T& k) { t.contains_near(k); }) {
+			std::cout << "\n2.4d Finger search:\n";
+			test_finger_search(sorted_tree, size);
+		}
+
 		// 2.5 Тест удаления 10% случайных элементов
 		std::cout << "\n2.5 10 percent removal tests:\n";
 		if constexpr (std::is_same_v<Tree, OptimalBST<T>>) {
@@ -219,8 +345,8 @@ private:
 		std::vector<T> random(size);
 
 		for (size_t i = 0; i < size; i++) {
-			sorted[i] = static_cast<T>(i);
-			random[i] = static_cast<T>(i);
+			sorted[i] = test_key(i);
+			random[i] = test_key(i);
 		}
 
 		std::shuffle(random.begin(), random.end(),
@@ -246,7 +372,7 @@ private:
 			<< "height = " << balanced.height() << "\n";
 
 		// Поиск (средний элемент)
-		T middle = static_cast<T>(size / 2);
+		T middle = test_key(size / 2);
 
 		start = std::chrono::high_resolution_clock::now();
 		for (int i = 0; i < 1000; i++) {
@@ -281,14 +407,14 @@ private:
 			if constexpr (std::is_same_v<Tree, OptimalBST<T>>) {
 				std::vector<T> data;
 				for (size_t i = 0; i < std::min(size, (size_t)100); i++) {
-					data.push_back(static_cast<T>(i * 2));
+					data.push_back(test_key(i * 2));
 				}
 				return build_and_test_tree_obst(data, "copy_move");
 			}
 			else {
 				Tree original;
 				for (size_t i = 0; i < std::min(size, (size_t)100); i++) {
-					original.insert(static_cast<T>(i * 2));
+					original.insert(test_key(i * 2));
 				}
 				return original;
 			}
@@ -343,7 +469,7 @@ private:
 
 		// Генерируем данные
 		for (size_t i = 0; i < size; i++) {
-			data[i] = static_cast<T>(i);
+			data[i] = test_key(i);
 		}
 		std::shuffle(data.begin(), data.end(), std::mt19937{ std::random_device{}() });
 
@@ -405,6 +531,325 @@ private:
 			<< " ms)\n\n";
 	}
 
+	static void bulk_build_test(size_t size) {
+		std::cout << "6. BULK BUILD TEST (size = " << size << ")\n";
+		std::cout << "-----------------------\n";
+
+		std::vector<T> data(size);
+		for (size_t i = 0; i < size; i++) {
+			data[i] = test_key(i);
+		}
+
+		Tree tree;
+		auto start = std::chrono::high_resolution_clock::now();
+		tree.build_from_sorted(data);
+		auto end = std::chrono::high_resolution_clock::now();
+		auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+
+		std::cout << "+ build_from_sorted: " << duration.count() << " ms, height: "
+			<< tree.height() << "\n";
+		assert(tree.size() == size);
+		assert(tree.inorder() == data);
+		verify_tree_integrity(tree, "tree after build_from_sorted");
+
+		// Дерево остаётся рабочим после построения
+		for (size_t i = 0; i < size; i += 2) {
+			tree.remove(data[i]);
+		}
+		assert(tree.size() == size / 2);
+		for (size_t i = 0; i < size; i += 2) {
+			tree.insert(data[i]);
+		}
+		assert(tree.inorder() == data);
+
+		// Неупорядоченный вход отклоняется, дерево не меняется
+		if (size >= 2) {
+			std::vector<T> unsorted = { data[1], data[0] };
+			[[maybe_unused]] bool thrown = false;
+			try {
+				tree.build_from_sorted(unsorted);
+			}
+			catch (const std::invalid_argument&) {
+				thrown = true;
+			}
+			assert(thrown);
+			assert(tree.size() == size);
+		}
+		// Параллельное построение из перемешанных данных с дубликатами
+		if constexpr (requires(Tree& t, std::vector<T> v) { t.build_from_unsorted(v); }) {
+			std::vector<T> shuffled = data;
+			shuffled.insert(shuffled.end(), data.begin(), data.begin() + size / 4);
+			std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937{ std::random_device{}() });
+
+			start = std::chrono::high_resolution_clock::now();
+			tree.build_from_unsorted(std::move(shuffled));
+			end = std::chrono::high_resolution_clock::now();
+			duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+
+			std::cout << "+ build_from_unsorted: " << duration.count() << " ms, height: "
+				<< tree.height() << "\n";
+			assert(tree.size() == size);
+			assert(tree.inorder() == data);
+			verify_tree_integrity(tree, "tree after build_from_unsorted");
+		}
+		std::cout << "+ Bulk build test completed\n\n";
+	}
+
+	// ==================== 7. Операции над множествами ====================
+	static void set_operations_test(size_t size) {
+		std::cout << "7. SET OPERATIONS TEST (size = " << size << ")\n";
+		std::cout << "-----------------------\n";
+
+		// Кратные 2 и кратные 3 - пересекаются по кратным 6
+		std::vector<T> evens, triples;
+		for (size_t i = 0; i < size; i++) {
+			if (i % 2 == 0) evens.push_back(test_key(i));
+			if (i % 3 == 0) triples.push_back(test_key(i));
+		}
+
+		std::vector<T> expected_union, expected_intersection, expected_difference;
+		std::set_union(evens.begin(), evens.end(), triples.begin(), triples.end(),
+			std::back_inserter(expected_union));
+		std::set_intersection(evens.begin(), evens.end(), triples.begin(), triples.end(),
+			std::back_inserter(expected_intersection));
+		std::set_difference(evens.begin(), evens.end(), triples.begin(), triples.end(),
+			std::back_inserter(expected_difference));
+
+		auto make_tree = [](const std::vector<T>& keys) {
+			std::vector<T> shuffled = keys;
+			std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937{ std::random_device{}() });
+			Tree tree;
+			for (const auto& key : shuffled) {
+				tree.insert(key);
+			}
+			return tree;
+		};
+
+		auto check = [](Tree& tree, const std::vector<T>& expected, const std::string& name) {
+			assert(tree.size() == expected.size());
+			assert(tree.inorder() == expected);
+			verify_tree_integrity(tree, name);
+
+			// Результат остаётся рабочим деревом
+			if (!expected.empty()) {
+				tree.remove(expected.front());
+				assert(!tree.contains(expected.front()));
+				tree.insert(expected.front());
+				assert(tree.size() == expected.size());
+			}
+		};
+
+		auto start = std::chrono::high_resolution_clock::now();
+		Tree united = make_tree(evens);
+		united.union_with(make_tree(triples));
+		auto end = std::chrono::high_resolution_clock::now();
+		auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+		std::cout << "+ union_with (with build): " << duration.count() << " ms, height: "
+			<< united.height() << "\n";
+		check(united, expected_union, "tree after union_with");
+
+		Tree intersected = make_tree(evens);
+		intersected.intersect_with(make_tree(triples));
+		check(intersected, expected_intersection, "tree after intersect_with");
+
+		Tree difference = make_tree(evens);
+		difference.difference_with(make_tree(triples));
+		check(difference, expected_difference, "tree after difference_with");
+
+		// Операции с пустым деревом
+		Tree with_empty = make_tree(evens);
+		with_empty.union_with(Tree{});
+		assert(with_empty.inorder() == evens);
+		with_empty.difference_with(Tree{});
+		assert(with_empty.inorder() == evens);
+		with_empty.intersect_with(Tree{});
+		assert(with_empty.empty() && with_empty.size() == 0);
+
+		std::cout << "+ Set operations test completed\n\n";
+	}
+
+	// ==================== 8. Разделение и соединение ====================
+	static void split_join_test(size_t size) {
+		std::cout << "8. SPLIT/JOIN TEST (size = " << size << ")\n";
+		std::cout << "-----------------------\n";
+
+		std::vector<T> data(size);
+		for (size_t i = 0; i < size; i++) {
+			data[i] = test_key(i);
+		}
+		std::vector<T> shuffled = data;
+		std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937{ std::random_device{}() });
+
+		Tree tree;
+		for (const auto& key : shuffled) {
+			tree.insert(key);
+		}
+
+		// split: слева ключи < key, справа >= key
+		size_t pivot = size / 3;
+		auto [left, right] = tree.split(test_key(pivot));
+		assert(tree.empty() && tree.size() == 0);
+		assert(left.size() == pivot && right.size() == size - pivot);
+		assert(left.inorder() == std::vector<T>(data.begin(), data.begin() + pivot));
+		assert(right.inorder() == std::vector<T>(data.begin() + pivot, data.end()));
+		verify_tree_integrity(left, "left part after split");
+		verify_tree_integrity(right, "right part after split");
+
+		// join возвращает исходное множество
+		Tree joined = Tree::join(std::move(left), std::move(right));
+		assert(joined.size() == size);
+		assert(joined.inorder() == data);
+		verify_tree_integrity(joined, "tree after join");
+
+		// Пересекающиеся диапазоны ключей отклоняются
+		if (size >= 2) {
+			Tree low, high;
+			low.insert(data[1]);
+			high.insert(data[0]);
+			[[maybe_unused]] bool thrown = false;
+			try {
+				Tree::join(std::move(low), std::move(high));
+			}
+			catch (const std::invalid_argument&) {
+				thrown = true;
+			}
+			assert(thrown);
+		}
+
+		// erase_range удаляет полуинтервал [lo, hi) и возвращает число удалённых
+		size_t lo = size / 4, hi = size / 2;
+		auto start = std::chrono::high_resolution_clock::now();
+		size_t erased = joined.erase_range(test_key(lo), test_key(hi));
+		auto end = std::chrono::high_resolution_clock::now();
+		auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+		std::cout << "+ erase_range of " << erased << " keys: " << duration.count() << " us\n";
+
+		std::vector<T> expected(data.begin(), data.begin() + lo);
+		expected.insert(expected.end(), data.begin() + hi, data.end());
+		assert(erased == hi - lo);
+		assert(joined.size() == expected.size());
+		assert(joined.inorder() == expected);
+		verify_tree_integrity(joined, "tree after erase_range");
+
+		// Пустой и уже удалённый диапазоны ничего не меняют
+		assert(joined.erase_range(test_key(hi), test_key(lo)) == 0);
+		assert(joined.erase_range(test_key(lo), test_key(hi)) == 0);
+		assert(joined.size() == expected.size());
+
+		std::cout << "+ Split/join test completed\n\n";
+	}
+
+	// ==================== 9. Порядковые статистики ====================
+	static void order_statistics_test(size_t size) {
+		std::cout << "9. ORDER STATISTICS TEST (size = " << size << ")\n";
+		std::cout << "-----------------------\n";
+
+		// Чётные ключи: rank(2i) = i, select(i) = 2i
+		std::vector<T> data;
+		for (size_t i = 0; i < size; i++) {
+			data.push_back(test_key(2 * i));
+		}
+		std::vector<T> shuffled = data;
+		std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937{ std::random_device{}() });
+
+		Tree tree;
+		for (const auto& key : shuffled) {
+			tree.insert(key);
+		}
+
+		auto start = std::chrono::high_resolution_clock::now();
+		for (size_t i = 0; i < size; i++) {
+			assert(tree.select(i) == data[i]);
+			assert(tree.rank(data[i]) == i);
+			assert(tree.rank(test_key(2 * i + 1)) == i + 1);
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+		auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+		std::cout << "+ " << 3 * size << " rank/select queries: " << duration.count() << " ms\n";
+
+		// count_range считает полуинтервал [lo, hi)
+		assert(tree.count_range(test_key(0), test_key(2 * size)) == size);
+		[[maybe_unused]] size_t in_range = std::count_if(data.begin(), data.end(),
+			[](const T& key) { return test_key(1) <= key && key < test_key(7); });
+		assert(tree.count_range(test_key(1), test_key(7)) == in_range);
+		assert(tree.count_range(test_key(10), test_key(10)) == 0);
+
+		// Размеры поддеревьев поддерживаются при удалении
+		for (size_t i = 0; i < size; i += 2) {
+			tree.remove(data[i]);
+		}
+		std::vector<T> remaining = tree.inorder();
+		for (size_t i = 0; i < remaining.size(); i++) {
+			assert(tree.select(i) == remaining[i]);
+		}
+
+		[[maybe_unused]] bool thrown = false;
+		try {
+			tree.select(tree.size());
+		}
+		catch (const std::out_of_range&) {
+			thrown = true;
+		}
+		assert(thrown);
+
+		std::cout << "+ Order statistics test completed\n\n";
+	}
+
+	// ==================== 10. Агрегаты поддеревьев ====================
+	static void aggregate_test(size_t size) {
+		using Aggregate = typename Tree::Node::aggregate_policy;
+
+		std::cout << "10. AGGREGATE TEST (size = " << size << ")\n";
+		std::cout << "-----------------------\n";
+
+		std::vector<T> data(size);
+		for (size_t i = 0; i < size; i++) {
+			data[i] = test_key(i);
+		}
+		std::vector<T> shuffled = data;
+		std::mt19937 gen(std::random_device{}());
+		std::shuffle(shuffled.begin(), shuffled.end(), gen);
+
+		Tree tree;
+		for (const auto& key : shuffled) {
+			tree.insert(key);
+		}
+
+		// Эталон - свёртка отсортированных ключей
+		[[maybe_unused]] auto fold = [](auto first, auto last) {
+			auto value = Aggregate::identity();
+			for (; first != last; ++first) {
+				value = Aggregate::combine(value, Aggregate::from_key(*first));
+			}
+			return value;
+		};
+
+		assert(tree.total_aggregate() == fold(data.begin(), data.end()));
+
+		std::uniform_int_distribution<size_t> dist(0, size);
+		size_t queries = std::min(size, (size_t)1000);
+		auto start = std::chrono::high_resolution_clock::now();
+		for (size_t q = 0; q < queries; q++) {
+			size_t lo = dist(gen), hi = dist(gen);
+			if (lo > hi) std::swap(lo, hi);
+			assert(tree.aggregate(test_key(lo), test_key(hi))
+				== fold(data.begin() + lo, data.begin() + hi));
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+		auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+		std::cout << "+ " << queries << " range aggregate queries (with reference fold): "
+			<< duration.count() << " us\n";
+
+		// Агрегаты поддерживаются при удалении
+		for (size_t i = 0; i < size; i += 3) {
+			tree.remove(data[i]);
+		}
+		std::vector<T> remaining = tree.inorder();
+		assert(tree.total_aggregate() == fold(remaining.begin(), remaining.end()));
+
+		std::cout << "+ Aggregate test completed\n\n";
+	}
+
 	// ==================== Вспомогательные методы ====================
 
 	//построение дерева	
@@ -419,7 +864,8 @@ private:
 		auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
 
 		std::cout << "  Built in " << duration.count() << " ms\n";
-		std::cout << "  Size: " << tree.size() << ", Height: " << tree.height() << "\n";
+		std::cout << "  Size: " << tree.size() << ", Height: " << tree.height()
+			<< ", Avg depth: " << tree.shape_profile().average_depth() << "\n";
 
 		// Проверяем корректность
 		verify_tree_integrity(tree, name + " tree after build");
@@ -539,6 +985,163 @@ private:
 	}
 
 	// тест поиска N/10 случайных чисел
+	// Дерево содержит ключи 0..size-1
+	static void test_ordered_navigation(const Tree& tree, size_t size) {
+		if (size == 0) return;
+
+		std::mt19937 gen(std::random_device{}());
+		std::uniform_int_distribution<size_t> dist(0, size - 1);
+		size_t query_count = std::max(size / 10, (size_t)1);
+
+		auto start = std::chrono::high_resolution_clock::now();
+		for (size_t q = 0; q < query_count; q++) {
+			size_t index = dist(gen);
+			T key = test_key(index);
+			assert(tree.lower_bound(key) && *tree.lower_bound(key) == key);
+			assert(tree.ceiling(key) && *tree.ceiling(key) == key);
+			assert(tree.floor(key) && *tree.floor(key) == key);
+
+			[[maybe_unused]] const T* next = tree.upper_bound(key);
+			assert(index + 1 == size ? next == nullptr : *next == test_key(index + 1));
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+		auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+		std::cout << "  " << 4 * query_count << " bound queries: " << duration.count() << " ms\n";
+
+		// Ключи за пределами дерева
+		[[maybe_unused]] const T last = test_key(size - 1);
+		assert(tree.lower_bound(test_key(size)) == nullptr);
+		assert(tree.upper_bound(last) == nullptr);
+		assert(tree.floor(test_key(size)) && *tree.floor(test_key(size)) == last);
+
+		// Обход диапазона [lo, hi)
+		size_t lo = dist(gen), hi = std::min(size, lo + 100);
+		std::vector<T> range;
+		tree.visit_range(test_key(lo), test_key(hi), [&](const T& key) {
+			range.push_back(key);
+		});
+		assert(range.size() == hi - lo);
+		for (size_t i = 0; i < range.size(); i++) {
+			assert(range[i] == test_key(lo + i));
+		}
+		std::cout << "  + Ordered navigation checked\n";
+
+		// Гетерогенный поиск: запрос другого типа сравнивается с ключами без построения T
+		if constexpr (std::integral<T>) {
+			using Wide = std::conditional_t<std::is_signed_v<T>, long long, unsigned long long>;
+			[[maybe_unused]] const Wide probe = static_cast<Wide>(dist(gen));
+			assert(tree.contains(probe));
+			assert(tree.lower_bound(probe) && *tree.lower_bound(probe) == static_cast<T>(probe));
+			assert(!tree.contains(static_cast<Wide>(size)));
+			std::cout << "  + Heterogeneous lookup checked\n";
+		}
+		else if constexpr (LookupKey<std::string_view, T>) {
+			const T key = test_key(dist(gen));
+			const T absent = TestKeys<T>::missing(key);
+			assert(tree.contains(std::string_view(key)));
+			assert(tree.lower_bound(std::string_view(key)) && *tree.lower_bound(std::string_view(key)) == key);
+			assert(!tree.contains(std::string_view(absent)));
+			std::cout << "  + Heterogeneous lookup by string_view checked\n";
+		}
+
+		// Отсортированный пакет за один проход: совпадает с поштучными запросами
+		if constexpr (requires(std::span<const T> keys, std::span<const T*> out) { tree.lower_bound_batch(keys, out); }) {
+			std::vector<T> batch(query_count);
+			for (auto& key : batch) key = test_key(dist(gen));
+			batch.push_back(test_key(size));  // за пределами дерева
+			std::sort(batch.begin(), batch.end());
+
+			std::vector<const T*> bounds(batch.size());
+			auto found = std::make_unique<bool[]>(batch.size());
+			start = std::chrono::high_resolution_clock::now();
+			tree.lower_bound_batch(std::span<const T>(batch), std::span<const T*>(bounds));
+			tree.contains_sorted_batch(std::span<const T>(batch), std::span<bool>(found.get(), batch.size()));
+			end = std::chrono::high_resolution_clock::now();
+			duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+
+			for (size_t i = 0; i < batch.size(); i++) {
+				assert(bounds[i] == tree.lower_bound(batch[i]));
+				assert(found[i] == (bounds[i] && *bounds[i] == batch[i]));
+			}
+			assert(!found[batch.size() - 1]);
+			std::cout << "  + Sorted batch of " << batch.size() << " keys (two walks): "
+				<< duration.count() << " ms\n";
+		}
+	}
+
+	// Снимок дерева с ключами 0..size-1: пакетный поиск совпадает с деревом
+	static void test_frozen_snapshot(const Tree& tree, size_t size) {
+		FrozenTree<T> frozen(tree);
+		assert(frozen.size() == tree.size());
+
+		std::mt19937 gen(std::random_device{}());
+		std::uniform_int_distribution<size_t> dist(0, 2 * size + 1);
+		std::vector<T> batch(std::max(size / 10, (size_t)1));
+		for (auto& key : batch) key = test_key(dist(gen));  // около половины - промахи
+
+		auto found = std::make_unique<bool[]>(batch.size());
+		auto start = std::chrono::high_resolution_clock::now();
+		frozen.contains_many(std::span<const T>(batch), std::span<bool>(found.get(), batch.size()));
+		auto end = std::chrono::high_resolution_clock::now();
+		auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+
+		for (size_t i = 0; i < batch.size(); i++) {
+			assert(found[i] == tree.contains(batch[i]));
+			assert(frozen.lower_bound(batch[i]) == nullptr
+				? tree.lower_bound(batch[i]) == nullptr
+				: *frozen.lower_bound(batch[i]) == *tree.lower_bound(batch[i]));
+		}
+		std::cout << "  + Frozen contains_many of " << batch.size() << " keys matches tree: "
+			<< duration.count() << " ms\n";
+	}
+
+	// Поиск от пальца на возрастающих и убывающих ключах, дописывание справа
+	static void test_finger_search(const Tree& tree, size_t size) {
+		Tree copy = tree;
+		size_t extra = std::max(size / 10, (size_t)1);
+
+		auto start = std::chrono::high_resolution_clock::now();
+		for (size_t i = 0; i < size + extra; i++) {
+			assert(copy.contains_near(test_key(i)) == (i < size));
+		}
+		for (size_t i = size + extra; i-- > 0;) {
+			assert(copy.contains_near(test_key(i)) == (i < size));
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+		auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+		std::cout << "  + contains_near over " << 2 * (size + extra) << " sequential keys: "
+			<< duration.count() << " ms\n";
+
+		start = std::chrono::high_resolution_clock::now();
+		for (size_t i = size; i < size + extra; i++) {
+			copy.insert(test_key(i));
+		}
+		end = std::chrono::high_resolution_clock::now();
+		duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+
+		assert(copy.size() == size + extra);
+		for (size_t i = 0; i < size + extra; i++) {
+			assert(copy.contains(test_key(i)));
+		}
+		assert(std::ranges::is_sorted(copy.inorder()));
+		std::cout << "  + Appended " << extra << " keys above maximum: " << duration.count() << " ms\n";
+
+		// Промах contains_near оставляет палец на пустом слоте; вставка от него
+		// не должна портить балансировку (у декартова дерева - порядок кучи)
+		size_t interleaved_count = std::min(size, (size_t)5000);
+		Tree interleaved, plain;
+		for (size_t i = 0; i < interleaved_count; i++) {
+			[[maybe_unused]] bool found = interleaved.contains_near(test_key(i));
+			assert(!found);
+			interleaved.insert(test_key(i));
+			plain.insert(test_key(i));
+		}
+		assert(interleaved.inorder() == plain.inorder());
+		assert(interleaved.height() <= 2 * plain.height() + 1);
+		std::cout << "  + contains_near miss before each of " << interleaved_count
+			<< " inserts: height " << interleaved.height() << " (plain insert: " << plain.height() << ")\n";
+	}
+
 	static void test_random_search_10_percent(Tree& tree, const std::vector<T>& all_data,
 		const std::string& tree_name) {
 		std::cout << "\n2.5 " << tree_name << " - Search 10% random elements:\n";
@@ -578,6 +1181,27 @@ private:
 			<< (duration.count() * 1000.0 / search_count) << " us per search\n";
 		std::cout << "  Size: " << tree.size() << ", Height: " << tree.height() << "\n";
 		std::cout << "  All " << found_count << " keys were found\n";
+
+		// Пакетный поиск тех же ключей и заведомых промахов (если дерево его поддерживает)
+		if constexpr (requires(std::span<const T> keys, std::span<bool> out) { tree.contains_many(keys, out); }) {
+			std::vector<T> batch = search_keys;
+			for (const auto& key : search_keys) {
+				batch.push_back(TestKeys<T>::missing(key));
+			}
+			auto found = std::make_unique<bool[]>(batch.size());
+
+			start = std::chrono::high_resolution_clock::now();
+			tree.contains_many(std::span<const T>(batch), std::span<bool>(found.get(), batch.size()));
+			end = std::chrono::high_resolution_clock::now();
+			duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+
+			for (size_t i = 0; i < batch.size(); i++) {
+				assert(found[i] == tree.contains(batch[i]));
+			}
+			assert(std::all_of(found.get(), found.get() + search_keys.size(), [](bool f) { return f; }));
+			std::cout << "  Batched contains_many of " << batch.size() << " keys (half misses): "
+				<< duration.count() << " ms\n";
+		}
 	}
 
 	// Тест "прогрев" — делаем много поисков, затем измеряем
@@ -587,13 +1211,13 @@ private:
 		std::cout << "\n2.5c " << tree_name << " - Warmup test:\n";
 		// 1. Прогрев
 		for (int i = 0; i < warmup_searches; i++) {
-			tree.find_and_update(rand() % size);
+			tree.find_and_update(test_key(rand() % size));
 		}
 
 		// 2. Измерение на прогретом дереве
 		auto start = std::chrono::high_resolution_clock::now();
 		for (int i = 0; i < measure_searches; i++) {
-			tree.find_and_update(rand() % size);
+			tree.find_and_update(test_key(rand() % size));
 		}
 		auto end = std::chrono::high_resolution_clock::now();
 		auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
@@ -694,6 +1318,38 @@ private:
 		tree.visit_inorder([&](const T& key) { visitor_inorder.push_back(key); });
 		assert(visitor_inorder == inorder);
 		std::cout << "    + Visitor in-order matches\n";
+
+		// Шаблонный visitor с ранней остановкой
+		if constexpr (requires { { tree.visit_inorder([](const T&) { return true; }) } -> std::same_as<bool>; }) {
+			size_t limit = inorder.size() / 2;
+			std::vector<T> prefix;
+			[[maybe_unused]] bool completed = tree.visit_inorder([&](const T& key) {
+				if (prefix.size() == limit) return false;
+				prefix.push_back(key);
+				return true;
+			});
+			assert(completed == (limit == inorder.size()));
+			assert(std::equal(prefix.begin(), prefix.end(), inorder.begin()));
+			assert(prefix.size() == limit);
+			std::cout << "    + Template visitor stops early\n";
+		}
+
+		// Итераторы: прямой и обратный проход совпадают с in-order
+		if constexpr (std::ranges::bidirectional_range<const Tree>) {
+			assert(std::equal(tree.begin(), tree.end(), inorder.begin(), inorder.end()));
+			assert(std::equal(std::make_reverse_iterator(tree.end()), std::make_reverse_iterator(tree.begin()),
+				inorder.rbegin(), inorder.rend()));
+			std::cout << "    + Iterators match in-order in both directions\n";
+		}
+
+		// Тот же обход через виртуальный интерфейс ITree
+		TreeAdapter<Tree> adapter(tree);
+		const ITree<T>& erased = adapter;
+		std::vector<T> erased_inorder;
+		erased.visit_inorder([&](const T& key) { erased_inorder.push_back(key); });
+		assert(erased_inorder == inorder);
+		assert(erased.size() == tree.size() && erased.height() == tree.height());
+		std::cout << "    + ITree adapter matches\n";
 	}
 
 	static void test_removal(Tree& tree, const std::vector<T>& data, const std::string& name) {
@@ -722,7 +1378,7 @@ private:
 		}
 
 		// Пытаемся удалить несуществующие элементы
-		T non_existent = static_cast<T>(data.size() + 1000);
+		T non_existent = test_key(data.size() + 1000);
 		size_t size_before = tree.size();
 		tree.remove(non_existent);
 		assert(tree.size() == size_before); // Размер не должен измениться
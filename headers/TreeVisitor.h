@@ -0,0 +1,23 @@
+﻿#pragma once
+#include <concepts>
+#include <type_traits>
+
+// Visitor для шаблонных обходов: вызывается с ключом и либо ничего
+// не возвращает, либо возвращает bool - false останавливает обход.
+// Вызов статический и встраивается, в отличие от std::function.
+template<typename V, typename T>
+concept KeyVisitor = std::invocable<V&, const T&> &&
+	(std::is_void_v<std::invoke_result_t<V&, const T&>> ||
+		std::convertible_to<std::invoke_result_t<V&, const T&>, bool>);
+
+// Вызов visitor; false - обход нужно прервать
+template<typename V, typename T>
+bool visit_key(V& visitor, const T& key) {
+	if constexpr (std::is_void_v<std::invoke_result_t<V&, const T&>>) {
+		visitor(key);
+		return true;
+	}
+	else {
+		return static_cast<bool>(visitor(key));
+	}
+}
@@ -0,0 +1,449 @@
+﻿#pragma once
+#include <iostream>
+#include <memory>
+#include <concepts>
+#include "TreeBase.h"
+#include <stack>
+#include <queue>
+#include <array>
+#include <cstdint>
+#include <ranges>
+#include <vector>
+#include <stdexcept>
+
+/**
+ * WAVL-дерево (weak AVL, Haeupler–Sen–Tarjan).
+ *
+ * Вместо высоты в узле хранится ранг; разность рангов родителя и ребёнка
+ * равна 1 или 2, у листа ранг 0 (ранг отсутствующего узла равен -1).
+ * Балансировка идёт снизу вверх по сохранённому пути: вставка и удаление
+ * делают O(1) амортизированно изменений рангов и не более двух поворотов,
+ * высота не превышает 2·log2(n).
+ */
+template <std::totally_ordered T>
+class WAVLTree : public TreeBase<WAVLTree<T>, T> {
+	friend TreeBase<WAVLTree, T>;  // root/node_count и хуки для общего кода
+
+public:
+
+	struct Node { //структура для узла
+		T key;
+		int8_t rank;  // ранг умещается в выравнивание после ключа
+		std::unique_ptr<Node> left;
+		std::unique_ptr<Node> right;
+
+		//Конструкторы и присваивание
+		explicit Node(T k)
+			: key(std::move(k)), rank(0), left(nullptr), right(nullptr) {
+		}
+
+		//Копирование
+		Node(const Node&) = delete;
+		Node& operator=(const Node&) = delete;
+
+		//Перемещение
+		Node(Node&& other) noexcept = default;
+		Node& operator=(Node&& other) noexcept = default;
+
+		~Node() = default;
+	};
+
+public:
+	//--------- конструкторы и операторы присваивания -------//
+
+	WAVLTree() = default;  // пустое дерево
+
+	WAVLTree(T key) : root(std::make_unique<Node>(key)), node_count(1) {};
+
+	// Конструктор копирования
+	WAVLTree(const WAVLTree& other)
+		: root(clone(other.root.get())), node_count(other.node_count), height_cache(other.height_cache) {};
+
+	// Конструктор перемещения
+	WAVLTree(WAVLTree&& other) noexcept
+		: root(std::move(other.root)), node_count(other.node_count), height_cache(other.height_cache) {
+		other.node_count = 0;
+		other.height_cache.invalidate();
+	}
+
+	~WAVLTree() {
+		this->clear();
+	};
+
+	// Оператор копирующего присваивания
+	WAVLTree& operator=(const WAVLTree& other) {
+		if (this != &other) {
+			root = clone(other.root.get());
+			node_count = other.node_count;
+			height_cache = other.height_cache;
+		}
+		return *this;
+	};
+
+	// Оператор перемещающего присваивания
+	WAVLTree& operator=(WAVLTree&& other) noexcept {
+		if (this != &other) {
+			this->clear();
+			root = std::move(other.root);
+			node_count = other.node_count;
+			height_cache = other.height_cache;
+			other.node_count = 0;
+			other.height_cache.invalidate();
+		}
+		return *this;
+	};
+
+	//--------- Основные операции -------//
+	//вставка (итеративно, по сохранённому пути). Возвращает указатель
+	//на ключ в дереве и true, если ключ добавлен
+	std::pair<const T*, bool> insert(const T& key) {
+		return insert_key(key);
+	}
+
+	//вставка перемещением: тяжёлый ключ не копируется
+	std::pair<const T*, bool> insert(T&& key) {
+		return insert_key(std::move(key));
+	}
+
+	//поиск элемента; K - T или сравнимый с ним тип запроса
+	template<typename K = T> requires LookupKey<K, T>
+	bool contains(const K& key) const {
+		const Node* current = root.get();
+		while (current) {
+			const auto order = compare_keys(key, current->key);
+			if (order < 0) {
+				current = current->left.get();
+			}
+			else if (order > 0) {
+				current = current->right.get();
+			}
+			else {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	//удаление элемента (итеративно, по сохранённому пути)
+	void remove(const T& key) {
+		Path path;
+		size_t depth = 0;
+		path[0] = &root;
+
+		while (*path[depth]) {
+			Node* current = path[depth]->get();
+			const auto order = compare_keys(key, current->key);
+			if (order < 0) {
+				path[depth + 1] = &current->left;
+			}
+			else if (order > 0) {
+				path[depth + 1] = &current->right;
+			}
+			else {
+				break;
+			}
+			++depth;
+		}
+
+		if (!*path[depth]) return;  // Ключ не найден
+
+		Node* target = path[depth]->get();
+		if (target->left && target->right) {
+			// Продолжаем путь до преемника и переносим его ключ в target
+			path[++depth] = &target->right;
+			while ((*path[depth])->left) {
+				path[depth + 1] = &(*path[depth])->left;
+				++depth;
+			}
+			target->key = std::move((*path[depth])->key);
+		}
+
+		// Теперь у удаляемого узла не более одного ребёнка
+		std::unique_ptr<Node>& slot = *path[depth];
+		std::unique_ptr<Node> child = slot->left
+			? std::move(slot->left) : std::move(slot->right);
+		slot = std::move(child);
+		--node_count;
+
+		rebalance_after_remove(path, depth);
+		height_cache.invalidate();
+	}
+
+	//--------- Массовое построение -------//
+	//построение идеально сбалансированного дерева из строго возрастающих ключей за O(n);
+	//прежнее содержимое заменяется
+	template<std::ranges::input_range Range>
+		requires std::convertible_to<std::ranges::range_reference_t<Range>, T>
+	void build_from_sorted(Range&& keys) {
+		auto nodes = make_sorted_nodes(keys);  // при ошибке дерево не меняется
+
+		this->clear();
+		node_count = nodes.size();
+		root = build_balanced(nodes, 0, nodes.size());
+		height_cache.invalidate();
+	}
+
+	//--------- Итераторы -------//
+	//begin()/end() - в TreeBase (см. TreeIterator.h)
+	using iterator = TreeIterator<Node>;
+	using const_iterator = iterator;
+
+	//--------- Метрики -------//
+	//высота (кэшируется до следующего изменения формы)
+	int height() const {
+		return height_cache.get([this] { return subtree_height(root.get()); });
+	}
+
+protected:
+	// Путь от корня: указатели на unique_ptr, владеющие узлами.
+	// Глубина WAVL-дерева не больше 2·log2(n) < 128, плюс слот для нового узла
+	static constexpr size_t MAX_DEPTH = 2 * 64 + 2;
+	using Path = std::array<std::unique_ptr<Node>*, MAX_DEPTH>;
+
+	//ключ перемещается в узел только после спуска
+	template<typename K>
+	std::pair<const T*, bool> insert_key(K&& key) {
+		Path path;
+		size_t depth = 0;
+		path[0] = &root;
+
+		while (*path[depth]) {
+			Node* current = path[depth]->get();
+			const auto order = compare_keys(key, current->key);
+			if (order < 0) {
+				path[depth + 1] = &current->left;
+			}
+			else if (order > 0) {
+				path[depth + 1] = &current->right;
+			}
+			else {
+				return { &current->key, false };  // Дубликат
+			}
+			++depth;
+		}
+
+		*path[depth] = std::make_unique<Node>(std::forward<K>(key));
+		Node* inserted = path[depth]->get();  // узлы при поворотах не перемещаются
+		++node_count;
+
+		// Без поворотов остальные узлы остаются на своих глубинах
+		if (rebalance_after_insert(path, depth)) {
+			height_cache.invalidate();
+		}
+		else {
+			height_cache.leaf_inserted(static_cast<int>(depth));
+		}
+		return { &inserted->key, true };
+	}
+
+	static int rank_of(const Node* node) {
+		return node ? node->rank : -1;
+	}
+
+	// --------- Вращения --------- //
+	// Поворот на месте: slot указывает на корень поддерева, ранги не меняются
+	static void rotate_left(std::unique_ptr<Node>& slot) {
+		auto y = std::move(slot->right);
+		slot->right = std::move(y->left);
+		y->left = std::move(slot);
+		slot = std::move(y);
+	}
+
+	static void rotate_right(std::unique_ptr<Node>& slot) {
+		auto y = std::move(slot->left);
+		slot->left = std::move(y->right);
+		y->right = std::move(slot);
+		slot = std::move(y);
+	}
+
+	// Новый узел на глубине depth: устраняем 0-детей, поднимаясь вверх.
+	// Возвращает true, если понадобились повороты
+	static bool rebalance_after_insert(Path& path, size_t depth) {
+		while (depth > 0) {
+			Node* x = path[depth]->get();
+			Node* parent = path[depth - 1]->get();
+			if (parent->rank != x->rank) return false;  // x не 0-ребёнок - инвариант восстановлен
+
+			bool x_is_left = parent->left.get() == x;
+			const Node* sibling = x_is_left ? parent->right.get() : parent->left.get();
+
+			if (parent->rank - rank_of(sibling) == 1) {
+				// Брат - 1-ребёнок: повышаем родителя и поднимаемся
+				++parent->rank;
+				--depth;
+				continue;
+			}
+
+			// Брат - 2-ребёнок: одно или два вращения завершают балансировку
+			Node* inner = x_is_left ? x->right.get() : x->left.get();
+			if (x->rank - rank_of(inner) == 2) {
+				if (x_is_left) rotate_right(*path[depth - 1]);
+				else rotate_left(*path[depth - 1]);
+				--parent->rank;
+			}
+			else {
+				if (x_is_left) {
+					rotate_left(parent->left);
+					rotate_right(*path[depth - 1]);
+				}
+				else {
+					rotate_right(parent->right);
+					rotate_left(*path[depth - 1]);
+				}
+				++inner->rank;
+				--x->rank;
+				--parent->rank;
+			}
+			return true;
+		}
+		return false;
+	}
+
+	// Узел на глубине depth удалён (слот может быть пустым): устраняем 3-детей
+	static void rebalance_after_remove(Path& path, size_t depth) {
+		if (depth == 0) return;
+
+		// Родитель стал листом ранга 1 (2,2-лист) - понижаем его
+		Node* parent = path[depth - 1]->get();
+		if (!parent->left && !parent->right && parent->rank == 1) {
+			parent->rank = 0;
+			--depth;
+		}
+
+		while (depth > 0) {
+			const Node* x = path[depth]->get();
+			parent = path[depth - 1]->get();
+			if (parent->rank - rank_of(x) != 3) return;
+
+			// x может отсутствовать, поэтому сторону определяем по слоту
+			bool x_is_left = path[depth] == &parent->left;
+			Node* sibling = x_is_left ? parent->right.get() : parent->left.get();
+
+			if (parent->rank - sibling->rank == 2) {
+				// Брат - 2-ребёнок: понижаем родителя
+				--parent->rank;
+				--depth;
+				continue;
+			}
+
+			int left_diff = sibling->rank - rank_of(sibling->left.get());
+			int right_diff = sibling->rank - rank_of(sibling->right.get());
+			if (left_diff == 2 && right_diff == 2) {
+				// Брат - 2,2-узел: понижаем обоих
+				--parent->rank;
+				--sibling->rank;
+				--depth;
+				continue;
+			}
+
+			// Вращения завершают балансировку
+			Node* outer = x_is_left ? sibling->right.get() : sibling->left.get();
+			Node* inner = x_is_left ? sibling->left.get() : sibling->right.get();
+
+			if (sibling->rank - rank_of(outer) == 1) {
+				if (x_is_left) rotate_left(*path[depth - 1]);
+				else rotate_right(*path[depth - 1]);
+				++sibling->rank;
+				--parent->rank;
+				if (!parent->left && !parent->right) --parent->rank;  // лист получает ранг 0
+			}
+			else {
+				if (x_is_left) {
+					rotate_right(parent->right);
+					rotate_left(*path[depth - 1]);
+				}
+				else {
+					rotate_left(parent->left);
+					rotate_right(*path[depth - 1]);
+				}
+				inner->rank += 2;
+				--sibling->rank;
+				parent->rank -= 2;
+			}
+			return;
+		}
+	}
+
+	// --------- Хуки TreeBase --------- //
+	//после clear() форма дерева изменилась
+	void on_clear() {
+		height_cache.invalidate();
+	}
+
+	//в print() рядом с ключом показывается ранг
+	void print_node(std::ostream& os, const Node* node) const {
+		os << node->key << "(r" << static_cast<int>(node->rank) << ")";
+	}
+
+	//узлы для строго возрастающей последовательности ключей (один проход выделения)
+	template<typename Range>
+	static std::vector<std::unique_ptr<Node>> make_sorted_nodes(Range&& keys) {
+		std::vector<std::unique_ptr<Node>> nodes;
+		if constexpr (std::ranges::sized_range<Range>) {
+			nodes.reserve(std::ranges::size(keys));
+		}
+
+		for (auto&& key : keys) {
+			auto node = std::make_unique<Node>(key);
+			if (!nodes.empty() && !(nodes.back()->key < node->key)) {
+				throw std::invalid_argument(
+					"build_from_sorted requires strictly increasing keys");
+			}
+			nodes.push_back(std::move(node));
+		}
+		return nodes;
+	}
+
+	// Сборка сбалансированного дерева из узлов [lo, hi); ранг равен высоте,
+	// как в AVL-дереве, поэтому все разности рангов 1 или 2
+	static std::unique_ptr<Node> build_balanced(
+		std::vector<std::unique_ptr<Node>>& nodes, size_t lo, size_t hi) {
+
+		if (lo >= hi) return nullptr;
+
+		size_t mid = lo + (hi - lo) / 2;
+		auto node = std::move(nodes[mid]);
+		node->left = build_balanced(nodes, lo, mid);
+		node->right = build_balanced(nodes, mid + 1, hi);
+		node->rank = static_cast<int8_t>(1 + std::max(rank_of(node->left.get()), rank_of(node->right.get())));
+		return node;
+	}
+
+	//-------------- Общие служебные функции ---------//
+
+	//служебная функция копирования дерева (итеративная)
+	static std::unique_ptr<Node> clone(const Node* source_root) {
+		if (!source_root) return nullptr;
+
+		auto copy = [](const Node* node) {
+			auto new_node = std::make_unique<Node>(node->key);
+			new_node->rank = node->rank;
+			return new_node;
+		};
+		auto new_root = copy(source_root);
+
+		std::stack<std::pair<const Node*, Node*>> stack;
+		stack.push({ source_root, new_root.get() });
+
+		while (!stack.empty()) {
+			auto [src_node, dst_node] = stack.top();
+			stack.pop();
+
+			if (src_node->left) {
+				dst_node->left = copy(src_node->left.get());
+				stack.push({ src_node->left.get(), dst_node->left.get() });
+			}
+			if (src_node->right) {
+				dst_node->right = copy(src_node->right.get());
+				stack.push({ src_node->right.get(), dst_node->right.get() });
+			}
+		}
+
+		return new_root;
+	}
+
+protected:
+	std::unique_ptr<Node> root = nullptr;
+	size_t node_count = 0;
+	HeightCache height_cache;  // высота, пересчитываемая после изменения формы
+};
@@ -7,12 +7,18 @@
 #include "RandomizedBST.h"
 #include "SplayTree.h"
 #include "OptimalTreap.h"
+#include "MultiSplayTree.h"
+#include "ScapegoatTree.h"
+#include "WAVLTree.h"
+#include "PrefixString.h"
+#include "SplayCacheTest.h"
 #include <cassert>
 #include <set>
 #include <chrono>
 #include <vector>
 #include <random>
 #include <numeric>
+#include <string>
 
 int main() {
 	setlocale(LC_ALL, "Russian");
@@ -92,6 +98,18 @@ int main() {
 
         TreeTest<int, OptimalTreap<int>>::comprehensive_test(n);
 
+        std::cout << "****** Multi-Splay Tree ****************\n";
+
+        TreeTest<int, MultiSplayTree<int>>::comprehensive_test(n);
+
+        std::cout << "****** Scapegoat Tree ******************\n";
+
+        TreeTest<int, ScapegoatTree<int>>::comprehensive_test(n);
+
+        std::cout << "****** WAVL Tree ***********************\n";
+
+        TreeTest<int, WAVLTree<int>>::comprehensive_test(n);
+
         n = 100000;
         std::cout << "-------- Часть 3b: n= " << n << "\n";
         std::cout << "(OBST не участвует в связи с ограничениями по памяти)\n";
@@ -126,6 +144,18 @@ int main() {
 
         TreeTest<int, OptimalTreap<int>>::comprehensive_test(n);
 
+        std::cout << "****** Multi-Splay Tree ****************\n";
+
+        TreeTest<int, MultiSplayTree<int>>::comprehensive_test(n);
+
+        std::cout << "****** Scapegoat Tree ******************\n";
+
+        TreeTest<int, ScapegoatTree<int>>::comprehensive_test(n);
+
+        std::cout << "****** WAVL Tree ***********************\n";
+
+        TreeTest<int, WAVLTree<int>>::comprehensive_test(n);
+
         n = 1000000;
         std::cout << "-------- Часть 3c: n= " << n << "\n";
         std::cout << "(OBST не участвует в связи с ограничениями по памяти)\n";
@@ -157,5 +187,104 @@ int main() {
         std::cout << "****** Optimal Treap *******************\n";
 
         TreeTest<int, OptimalTreap<int>>::comprehensive_test(n);
+
+        std::cout << "****** Multi-Splay Tree ****************\n";
+
+        TreeTest<int, MultiSplayTree<int>>::comprehensive_test(n);
+
+        std::cout << "****** Scapegoat Tree ******************\n";
+
+        TreeTest<int, ScapegoatTree<int>>::comprehensive_test(n);
+
+        std::cout << "****** WAVL Tree ***********************\n";
+
+        TreeTest<int, WAVLTree<int>>::comprehensive_test(n);
+    }
+
+    //массовая загрузка неупорядоченных ключей
+    {
+        int n = 10000000;
+        std::cout << "-------- Часть 4: параллельная загрузка, n= " << n << "\n";
+
+        std::vector<int> keys(n);
+        std::iota(keys.begin(), keys.end(), 0);
+        std::shuffle(keys.begin(), keys.end(), std::mt19937{ std::random_device{}() });
+
+        auto bulk_load = [&keys](auto& tree, const char* name) {
+            auto start = std::chrono::high_resolution_clock::now();
+            tree.build_from_unsorted(keys);
+            auto end = std::chrono::high_resolution_clock::now();
+            auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+
+            std::cout << name << ": " << duration.count() << " ms, size: " << tree.size()
+                << ", height: " << tree.height() << "\n";
+        };
+
+        AVLTree<int> avl;
+        bulk_load(avl, "AVLTree");
+
+        Treap<int> treap;
+        bulk_load(treap, "Treap");
+    }
+
+    //деревья с дополнительными полями в узлах: порядковые статистики и агрегаты
+    {
+        int n = 100000;
+        std::cout << "-------- Часть 5: порядковые статистики и агрегаты, n= " << n << "\n";
+
+        std::cout << "****** AVLTree (order statistics) ******\n";
+
+        TreeTest<int, AVLTree<int, true>>::comprehensive_test(n);
+
+        std::cout << "****** Treap (order statistics) ********\n";
+
+        TreeTest<int, Treap<int, true>>::comprehensive_test(n);
+
+        std::cout << "****** AVLTree (sum aggregate) *********\n";
+
+        TreeTest<int, AVLTree<int, false, SumAggregate<int, long long>>>::comprehensive_test(n);
+
+        std::cout << "****** Treap (max aggregate) ***********\n";
+
+        TreeTest<int, Treap<int, false, MaxAggregate<int>>>::comprehensive_test(n);
+    }
+
+    //строковые ключи: обычные строки и строки с префиксом, хранимым в узле
+    {
+        int n = 100000;
+        std::cout << "-------- Часть 6: строковые ключи, n= " << n << "\n";
+
+        std::cout << "****** AVLTree (std::string) ***********\n";
+
+        TreeTest<std::string, AVLTree<std::string>>::comprehensive_test(n);
+
+        std::cout << "****** AVLTree (PrefixString) **********\n";
+
+        TreeTest<PrefixString, AVLTree<PrefixString>>::comprehensive_test(n);
+
+        std::cout << "****** Treap (std::string) *************\n";
+
+        TreeTest<std::string, Treap<std::string>>::comprehensive_test(n);
+
+        std::cout << "****** Treap (PrefixString) ************\n";
+
+        TreeTest<PrefixString, Treap<PrefixString>>::comprehensive_test(n);
+
+        std::cout << "****** Splay Tree (PrefixString) *******\n";
+
+        TreeTest<PrefixString, SplayTree<PrefixString>>::comprehensive_test(n);
+    }
+
+    //кэш ограниченной ёмкости на splay-дереве
+    {
+        std::cout << "-------- Часть 7: SplayCache\n";
+
+        std::cout << "****** SplayCache (capacity 1) *********\n";
+
+        SplayCacheTest<int>::comprehensive_test(1);
+
+        std::cout << "****** SplayCache (capacity 1000) ******\n";
+
+        SplayCacheTest<int>::comprehensive_test(1000);
     }
 }
\ No newline at end of file